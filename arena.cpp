@@ -0,0 +1,264 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+
+namespace gph
+{
+
+// Stored in the SURFACE_ALIGN bytes in front of every surface.
+struct SurfaceHeader
+{
+	void*  base;
+	size_t mapped;	// 0 when the block came from posix_memalign
+	size_t bytes;
+};
+
+static const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+static std::atomic<uint64_t> heapAllocations(0);
+
+uint64_t heap_allocation_count() { return heapAllocations.load(std::memory_order_relaxed); }
+
+static inline void count_allocation()
+{
+#ifdef GPH_COUNT_ALLOCATIONS
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+#endif
+}
+
+void* alloc_surface(size_t bytes, bool hugePages)
+{
+	size_t		   total = bytes + SURFACE_ALIGN;
+	unsigned char* base	 = nullptr;
+	size_t		   mapped = 0;
+
+	if (hugePages)
+	{
+		mapped	= (total + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+		void* p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p != MAP_FAILED)
+				madvise(p, mapped, MADV_HUGEPAGE);
+		}
+		base = p == MAP_FAILED ? nullptr : (unsigned char*) p;
+	}
+	else
+	{
+		void* p = nullptr;
+		if (posix_memalign(&p, SURFACE_ALIGN, total) == 0)
+			base = (unsigned char*) p;
+	}
+	if (base == nullptr)
+	{
+		std::cout << "Surface alloc fatal error!" << std::endl;
+		exit(1);
+	}
+
+	count_allocation();
+	SurfaceHeader* header = (SurfaceHeader*) base;
+	header->base		  = base;
+	header->mapped		  = mapped;
+	header->bytes		  = bytes;
+	return base + SURFACE_ALIGN;
+}
+
+size_t surface_capacity(const void* pixels)
+{
+	return ((const SurfaceHeader*) ((const unsigned char*) pixels - SURFACE_ALIGN))->bytes;
+}
+
+void free_surface(void* pixels)
+{
+	if (pixels == nullptr)
+		return;
+	SurfaceHeader* header = (SurfaceHeader*) ((unsigned char*) pixels - SURFACE_ALIGN);
+	if (header->mapped)
+		munmap(header->base, header->mapped);
+	else
+		free(header->base);
+}
+
+SurfacePool::~SurfacePool()
+{
+	for (void* pixels : m_Free)
+		free_surface(pixels);
+}
+
+void* SurfacePool::acquire(size_t bytes, bool hugePages)
+{
+	int best = -1;
+	for (int i = 0; i < POOL_SLOTS; ++i)
+	{
+		if (m_Free[i] && surface_capacity(m_Free[i]) >= bytes
+			&& (best < 0 || surface_capacity(m_Free[i]) < surface_capacity(m_Free[best])))
+			best = i;
+	}
+	if (best < 0)
+		return alloc_surface(bytes, hugePages);
+	void* pixels  = m_Free[best];
+	m_Free[best] = nullptr;
+	return pixels;
+}
+
+void SurfacePool::release(void* pixels)
+{
+	if (pixels == nullptr)
+		return;
+	// When full, evict the smallest surface; the big ones are the expensive ones.
+	int slot = 0;
+	for (int i = 0; i < POOL_SLOTS; ++i)
+	{
+		if (m_Free[i] == nullptr)
+		{
+			slot = i;
+			break;
+		}
+		if (surface_capacity(m_Free[i]) < surface_capacity(m_Free[slot]))
+			slot = i;
+	}
+	if (m_Free[slot] && surface_capacity(pixels) < surface_capacity(m_Free[slot]))
+	{
+		free_surface(pixels);
+		return;
+	}
+	free_surface(m_Free[slot]);
+	m_Free[slot] = pixels;
+}
+
+FrameArena::FrameArena(size_t bytes)
+: m_Block(nullptr)
+, m_Capacity(0)
+, m_Offset(0)
+, m_BlockBytes(bytes)
+{
+	new_block(bytes);
+}
+
+FrameArena::~FrameArena()
+{
+	free_overflow();
+	free_surface(m_Block);
+}
+
+void FrameArena::new_block(size_t bytes)
+{
+	m_Block	   = (unsigned char*) alloc_surface(bytes + SURFACE_ALIGN);
+	m_Capacity = bytes + SURFACE_ALIGN;
+	m_Offset   = SURFACE_ALIGN;
+	++m_HeapAllocations;
+}
+
+void FrameArena::free_overflow()
+{
+	while (m_Overflow)
+	{
+		Overflow* next = m_Overflow->next;
+		free_surface(m_Overflow);
+		m_Overflow = next;
+	}
+}
+
+// Rounds the absolute address rather than the offset, since blocks are only
+// SURFACE_ALIGN-aligned.
+static size_t aligned_offset(const unsigned char* block, size_t offset, size_t align)
+{
+	uintptr_t address = (uintptr_t) (block + offset);
+	return offset + (((address + align - 1) & ~(uintptr_t) (align - 1)) - address);
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align)
+{
+	assert(align != 0 && (align & (align - 1)) == 0);
+	size_t offset = aligned_offset(m_Block, m_Offset, align);
+	if (offset + bytes > m_Capacity)
+	{
+		Overflow* parked = (Overflow*) m_Block;
+		parked->next	 = m_Overflow;
+		m_Overflow		 = parked;
+		m_Used += m_Offset - SURFACE_ALIGN;
+
+		// bytes + align always fits whatever padding the alignment needs.
+		new_block(std::max(m_Capacity * 2, bytes + align));
+		offset = aligned_offset(m_Block, m_Offset, align);
+	}
+	m_Offset = offset + bytes;
+	return m_Block + offset;
+}
+
+void FrameArena::reset()
+{
+	if (m_Overflow)
+	{
+		// This frame needed more than one block: replace them all with a
+		// single block sized for it.
+		size_t needed = used();
+		free_overflow();
+		free_surface(m_Block);
+		m_Used = 0;
+		new_block(std::max(needed * 2, m_BlockBytes));
+	}
+	m_Offset				= SURFACE_ALIGN;
+	m_FrameStartAllocations = m_HeapAllocations;
+}
+
+};
+
+#ifdef GPH_COUNT_ALLOCATIONS
+// Global operator new replacements so heap_allocation_count() sees every
+// container, std::function and string allocation, not just arena blocks.
+// Opt-in, since they replace the allocator of every program linking this.
+// Every form is replaced, so no block crosses between this and the default
+// allocator.
+static void* counted_alloc(size_t bytes, size_t align)
+{
+	gph::count_allocation();
+	void* p = nullptr;
+	if (align <= alignof(std::max_align_t))
+		p = malloc(bytes ? bytes : 1);
+	else if (posix_memalign(&p, align, bytes ? bytes : 1) != 0)
+		p = nullptr;
+	return p;
+}
+
+static void* counted_new(size_t bytes, size_t align)
+{
+	void* p = counted_alloc(bytes, align);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t bytes) { return counted_new(bytes, 0); }
+void* operator new[](size_t bytes) { return counted_new(bytes, 0); }
+void* operator new(size_t bytes, std::align_val_t align) { return counted_new(bytes, (size_t) align); }
+void* operator new[](size_t bytes, std::align_val_t align) { return counted_new(bytes, (size_t) align); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return counted_alloc(bytes, 0); }
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return counted_alloc(bytes, 0); }
+void* operator new(size_t bytes, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(bytes, (size_t) align);
+}
+void* operator new[](size_t bytes, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	return counted_alloc(bytes, (size_t) align);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+#endif
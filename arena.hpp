@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace gph
+{
+
+const size_t SURFACE_ALIGN = 64;
+
+// 64-byte aligned pixel storage. With hugePages the block is mapped with
+// MAP_HUGETLB, falling back to transparent huge pages when none are reserved.
+void*  alloc_surface(size_t bytes, bool hugePages = false);
+void   free_surface(void* pixels);
+size_t surface_capacity(const void* pixels);
+
+// Heap allocations made through operator new or alloc_surface since startup,
+// on every thread. Only counted when arena.cpp is built with
+// GPH_COUNT_ALLOCATIONS, which also replaces the global operator new/delete;
+// always 0 otherwise.
+uint64_t heap_allocation_count();
+
+// Keeps released surfaces for reuse, so buffers that come and go with window
+// resizes or render-scale changes are recycled instead of reallocated.
+class SurfacePool
+{
+public:
+	// Smallest cached surface holding at least bytes, or a fresh one.
+	void* acquire(size_t bytes, bool hugePages = false);
+	void  release(void* pixels);
+
+	SurfacePool() = default;
+	~SurfacePool();
+
+	SurfacePool(const SurfacePool&)			   = delete;
+	SurfacePool& operator=(const SurfacePool&) = delete;
+
+protected:
+	static const int POOL_SLOTS = 8;
+
+	void* m_Free[POOL_SLOTS] = {};
+};
+
+// Bump allocator for data that only lives for one frame. reset() is O(1): it
+// rewinds the offset. When a frame overflows the block, overflow chunks are
+// chained on, and the next reset() replaces everything with one block big
+// enough for that frame, so steady-state frames never touch the heap.
+// heap_allocations() counts every block ever taken from the heap.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t bytes = 1 << 20);
+	~FrameArena();
+
+	// align may be any power of two, including ones above SURFACE_ALIGN.
+	void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+	void  reset();
+
+	template <typename T> T* allocate_array(size_t count) { return (T*) allocate(count * sizeof(T), alignof(T)); }
+
+	size_t	 used() const { return m_Used + m_Offset - SURFACE_ALIGN; }
+	size_t	 capacity() const { return m_Capacity - SURFACE_ALIGN; }
+	uint64_t heap_allocations() const { return m_HeapAllocations; }
+	uint64_t frame_heap_allocations() const { return m_HeapAllocations - m_FrameStartAllocations; }
+
+	FrameArena(const FrameArena&)			 = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+protected:
+	// Every block keeps its first SURFACE_ALIGN bytes for this link, so
+	// chaining a full block needs no extra allocation.
+	struct Overflow
+	{
+		Overflow* next;
+	};
+	static_assert(sizeof(Overflow) <= SURFACE_ALIGN, "Overflow link must fit the block header");
+
+	void new_block(size_t bytes);
+	void free_overflow();
+
+	unsigned char* m_Block;
+	size_t		   m_Capacity;
+	size_t		   m_Offset;
+	size_t		   m_Used = 0;	// bytes handed out from blocks before m_Block this frame
+	Overflow*	   m_Overflow = nullptr;
+	size_t		   m_BlockBytes;
+	uint64_t	   m_HeapAllocations	   = 0;
+	uint64_t	   m_FrameStartAllocations = 0;
+};
+
+// std-compatible allocator over a FrameArena, e.g.
+//   std::vector<Vector2, ArenaAllocator<Vector2>> spans(ArenaAllocator<Vector2>(&arena));
+// deallocate() is a no-op; memory comes back when the arena resets, so these
+// containers must not outlive the frame.
+template <typename T> class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	explicit ArenaAllocator(FrameArena* aArena)
+	: arena(aArena)
+	{
+	}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other)
+	: arena(other.arena)
+	{
+	}
+
+	T*	 allocate(size_t n) { return arena->allocate_array<T>(n); }
+	void deallocate(T*, size_t) {}
+
+	template <typename U> bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U> bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+
+	FrameArena* arena;
+};
+
+};
@@ -0,0 +1,93 @@
+#include "assetpack.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace gph
+{
+
+AssetPack::~AssetPack() { close(); }
+
+bool AssetPack::open(const char* path)
+{
+	close();
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		std::cout << "Asset pack open error: " << path << std::endl;
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(PackHeader))
+	{
+		std::cout << "Asset pack too small: " << path << std::endl;
+		::close(fd);
+		return false;
+	}
+	m_Size	  = info.st_size;
+	m_Mapping = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (m_Mapping == MAP_FAILED)
+	{
+		std::cout << "Asset pack mmap error: " << path << std::endl;
+		m_Mapping = nullptr;
+		m_Size	  = 0;
+		return false;
+	}
+
+	const unsigned char* base	= (const unsigned char*) m_Mapping;
+	const PackHeader*	 header = (const PackHeader*) base;
+	if (memcmp(header->magic, PACK_MAGIC, 4) != 0 || header->version != PACK_VERSION
+		|| sizeof(PackHeader) + (uint64_t) header->count * sizeof(PackEntry) > m_Size)
+	{
+		std::cout << "Asset pack header invalid: " << path << std::endl;
+		close();
+		return false;
+	}
+
+	m_Entries = (const PackEntry*) (base + sizeof(PackHeader));
+	surfaces.reserve(header->count);
+	for (uint32_t i = 0; i < header->count; ++i)
+	{
+		const PackEntry& entry = m_Entries[i];
+		if (entry.offset % PACK_ALIGN != 0 || entry.offset > m_Size || entry.size > m_Size - entry.offset
+			|| memchr(entry.name, 0, PACK_NAME_BYTES) == nullptr
+			|| (uint64_t) entry.stride * entry.height > entry.size || entry.stride < (uint64_t) entry.width * 4)
+		{
+			std::cout << "Asset pack entry invalid: " << i << std::endl;
+			close();
+			return false;
+		}
+		surfaces.push_back(Surface(base + entry.offset,
+								   entry.width,
+								   entry.height,
+								   entry.stride,
+								   entry.flags & PACK_PREMULTIPLIED));
+	}
+	return true;
+}
+
+void AssetPack::close()
+{
+	if (m_Mapping)
+		munmap(m_Mapping, m_Size);
+	m_Mapping = nullptr;
+	m_Size	  = 0;
+	m_Entries = nullptr;
+	surfaces.clear();
+}
+
+const char* AssetPack::name(int index) const { return m_Entries[index].name; }
+
+const Surface* AssetPack::find(const char* aName) const
+{
+	for (int i = 0; i < count(); ++i)
+	{
+		if (strncmp(m_Entries[i].name, aName, PACK_NAME_BYTES) == 0)
+			return &surfaces[i];
+	}
+	return nullptr;
+}
+
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "graphics.hpp"
+#include <string>
+#include <vector>
+
+namespace gph
+{
+
+// Asset pack layout (little endian), written by packtool:
+//   PackHeader
+//   PackEntry[count]
+//   pixel data, every image starting on a PACK_ALIGN boundary
+// Images are stored as BGRA rows of stride bytes, ready for ImageFill.
+const char	   PACK_MAGIC[4]   = { 'G', 'P', 'A', 'K' };
+const uint32_t PACK_VERSION	   = 1;
+const uint32_t PACK_ALIGN	   = 64;
+const uint32_t PACK_NAME_BYTES = 48;
+
+const uint32_t PACK_PREMULTIPLIED = 1 << 0;
+
+struct PackHeader
+{
+	char	 magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t reserved;
+};
+
+struct PackEntry
+{
+	char	 name[PACK_NAME_BYTES];
+	uint32_t width, height, stride, flags;
+	uint64_t offset, size;
+};
+
+static_assert(sizeof(PackHeader) == 16, "PackHeader layout");
+static_assert(sizeof(PackEntry) == 80, "PackEntry layout");
+
+// Maps a pack file read-only and hands out surfaces pointing straight into the
+// mapping, so nothing is decoded or copied at load time.
+class AssetPack
+{
+public:
+	bool open(const char* path);
+	void close();
+
+	int			   count() const { return (int) surfaces.size(); }
+	const Surface& operator[](int index) const { return surfaces[index]; }
+	const char*	   name(int index) const;
+	const Surface* find(const char* aName) const;
+
+	AssetPack() = default;
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+	~AssetPack();
+
+protected:
+	void*				  m_Mapping = nullptr;
+	size_t				  m_Size	= 0;
+	const PackEntry*	  m_Entries = nullptr;
+	std::vector<Surface> surfaces;
+};
+
+};
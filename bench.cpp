@@ -0,0 +1,124 @@
+// Headless micro-benchmarks for the engine's batch paths.
+// Usage: ./bench [iterations]
+// tween: 10k tweens across all easing curves, time per update(dt).
+// drawlist: 200 overlapping opaque and translucent cards, painted in z order
+// versus through a DrawList, with the number of FillStyle calls each makes.
+#include "drawlist.hpp"
+#include "tween.hpp"
+#include <chrono>
+
+using namespace gph;
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void bench_tween(int iterations)
+{
+	const int		   count = 10000;
+	std::vector<float> values(count);
+	TweenSystem		   tweens;
+	for (int i = 0; i < count; ++i)
+		tweens.add(&values[i], 1000, 1e6f, (Ease) (i % (int) Ease::COUNT));
+
+	tweens.update(1 / 60.0f);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i)
+		tweens.update(1 / 60.0f);
+	double elapsed = seconds_since(start);
+	printf("tween: %d tweens, %.1f us per update\n", count, elapsed / iterations * 1e6);
+}
+
+// Counts how many pixels it was asked to shade.
+class CountingFill : public FillStyle
+{
+public:
+	Color		 color;
+	mutable long calls = 0;
+
+	explicit CountingFill(Color aColor)
+	: color(aColor)
+	{
+	}
+	Color operator()(Vector2 aPos) const override
+	{
+		++calls;
+		return color;
+	}
+	bool opaque() const override { return color.a == 255; }
+};
+
+static void bench_drawlist(int iterations)
+{
+	const int W = 640, H = 480, count = 200;
+	struct Card
+	{
+		int			 z;
+		Vector2		 pos;
+		CountingFill fill;
+	};
+	std::vector<Card> cards;
+	srand(3);
+	for (int i = 0; i < count; ++i)
+	{
+		Color color(rand() % 256, rand() % 256, rand() % 256, rand() % 4 == 0 ? 128 : 255);
+		cards.push_back({ rand() % 20, Vector2(rand() % (W - 160), rand() % (H - 220)), CountingFill(color) });
+	}
+	std::vector<int> order(count);
+	for (int i = 0; i < count; ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return cards[a].z < cards[b].z; });
+
+	Canvas painter(W, H), sorted(W, H);
+	auto   start = std::chrono::steady_clock::now();
+	for (int n = 0; n < iterations; ++n)
+	{
+		painter.clear();
+		for (int i : order)
+			painter.fill_rectangle(cards[i].pos, 160, 220, cards[i].fill);
+	}
+	double paintTime = seconds_since(start);
+	long   paintCalls = 0;
+	for (Card& card : cards)
+	{
+		paintCalls += card.fill.calls;
+		card.fill.calls = 0;
+	}
+
+	DrawList list(sorted);
+	start = std::chrono::steady_clock::now();
+	for (int n = 0; n < iterations; ++n)
+	{
+		sorted.clear();
+		for (const Card& card : cards)
+			list.fill_rectangle(card.z, card.pos, 160, 220, card.fill);
+		list.flush();
+	}
+	double sortedTime  = seconds_since(start);
+	long   sortedCalls = 0;
+	for (const Card& card : cards)
+		sortedCalls += card.fill.calls;
+
+	bool same = memcmp(painter.pixels(), sorted.pixels(), (size_t) W * H * 4) == 0;
+	printf("drawlist: %d cards, painter %ld fill calls %.1f us, depth sorted %ld fill calls %.1f us, %s\n",
+		   count,
+		   paintCalls / iterations,
+		   paintTime / iterations * 1e6,
+		   sortedCalls / iterations,
+		   sortedTime / iterations * 1e6,
+		   same ? "images match" : "IMAGES DIFFER");
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 1000;
+	if (iterations <= 0)
+	{
+		std::cout << "Usage: " << argv[0] << " [iterations]" << std::endl;
+		return 1;
+	}
+	bench_tween(iterations);
+	bench_drawlist(std::max(iterations / 100, 1));
+	return 0;
+}
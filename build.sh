@@ -1 +1,4 @@
-clang++ --debug main.cpp graphics.cpp -o main -ldl -lX11 -lm
+clang++ --debug -DGPH_COUNT_ALLOCATIONS main.cpp graphics.cpp window.cpp assetpack.cpp capture.cpp trace.cpp tween.cpp arena.cpp upscale.cpp shadow.cpp drawlist.cpp -o main -pthread -ldl -lX11 -lm
+clang++ --debug packtool.cpp -o packtool
+clang++ -O2 replay.cpp graphics.cpp trace.cpp arena.cpp -o replay -lm
+clang++ -O2 bench.cpp tween.cpp drawlist.cpp graphics.cpp trace.cpp arena.cpp -o bench -lm
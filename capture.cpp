@@ -0,0 +1,188 @@
+#include "capture.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace gph
+{
+
+FrameCapture::FrameCapture(const std::string& path, int width, int height, CaptureFormat format, int poolSize, int fps)
+: WIDTH(width)
+, HEIGHT(height)
+, FRAME_BYTES(4 * width * height)
+, m_Format(format)
+, m_ResizeScratch(width * sizeof(int) + 2 * SURFACE_ALIGN)
+{
+	m_File = fopen(path.c_str(), "wb");
+	if (m_File == nullptr)
+	{
+		std::cout << "Frame capture cannot open " << path << std::endl;
+		return;
+	}
+
+	for (int i = 0; i < poolSize; ++i)
+	{
+		unsigned char* buffer = (unsigned char*) malloc(FRAME_BYTES);
+		if (buffer == nullptr)
+		{
+			std::cout << "Frame capture buffer malloc fatal error!" << std::endl;
+			exit(1);
+		}
+		m_Pool.push_back(buffer);
+		m_Free.push_back(buffer);
+	}
+
+	if (m_Format == CaptureFormat::Y4M)
+		fprintf(m_File, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", WIDTH, HEIGHT, fps);
+	else if (m_Format == CaptureFormat::DELTA)
+	{
+		uint32_t header[2] = { (uint32_t) WIDTH, (uint32_t) HEIGHT };
+		fwrite("GDLT", 1, 4, m_File);
+		fwrite(header, sizeof(header), 1, m_File);
+	}
+
+	m_Writer = std::thread(&FrameCapture::writer, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+	if (m_File == nullptr)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Ready.notify_one();
+	m_Writer.join();
+	fclose(m_File);
+	for (unsigned char* buffer : m_Pool)
+		free(buffer);
+}
+
+void FrameCapture::submit(const unsigned char* bgra, int width, int height)
+{
+	uint32_t index = m_Submitted++;
+	if (m_File == nullptr || width <= 0 || height <= 0)
+	{
+		++m_Dropped;
+		return;
+	}
+
+	unsigned char* buffer = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Free.empty())
+		{
+			buffer = m_Free.back();
+			m_Free.pop_back();
+		}
+	}
+	if (buffer == nullptr)
+	{
+		++m_Dropped;
+		return;
+	}
+
+	if (width == WIDTH && height == HEIGHT)
+		memcpy(buffer, bgra, FRAME_BYTES);
+	else
+	{
+		upscale_nearest(bgra, width, height, width * 4, buffer, WIDTH, HEIGHT, WIDTH * 4, m_ResizeScratch);
+		m_ResizeScratch.reset();
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.push_back({ buffer, index });
+	}
+	m_Ready.notify_one();
+}
+
+void FrameCapture::writer()
+{
+	for (;;)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Ready.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+			if (m_Queue.empty())
+				return;
+			frame = m_Queue.front();
+			m_Queue.pop_front();
+		}
+
+		write_frame(frame);
+		++m_Written;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Free.push_back(frame.pixels);
+	}
+}
+
+void FrameCapture::write_frame(const Frame& frame)
+{
+	const unsigned char* src	  = frame.pixels;
+	int					 pixels	  = WIDTH * HEIGHT;
+	int					 rowBytes = WIDTH * 4;
+
+	switch (m_Format)
+	{
+	case CaptureFormat::PPM:
+	{
+		m_Scratch.resize(pixels * 3);
+		for (int i = 0; i < pixels; ++i)
+		{
+			m_Scratch[i * 3 + 0] = src[i * 4 + 2];	// R
+			m_Scratch[i * 3 + 1] = src[i * 4 + 1];	// G
+			m_Scratch[i * 3 + 2] = src[i * 4 + 0];	// B
+		}
+		fprintf(m_File, "P6\n%d %d\n255\n", WIDTH, HEIGHT);
+		fwrite(m_Scratch.data(), 1, m_Scratch.size(), m_File);
+		break;
+	}
+	case CaptureFormat::Y4M:
+	{
+		// BT.601 full range in 8.8 fixed-point, one plane each for Y, U and V.
+		m_Scratch.resize(pixels * 3);
+		unsigned char* y = m_Scratch.data();
+		unsigned char* u = y + pixels;
+		unsigned char* v = u + pixels;
+		for (int i = 0; i < pixels; ++i)
+		{
+			int b = src[i * 4 + 0], g = src[i * 4 + 1], r = src[i * 4 + 2];
+			y[i]  = (77 * r + 150 * g + 29 * b + 128) >> 8;
+			u[i]  = std::min(255, std::max(0, ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128));
+			v[i]  = std::min(255, std::max(0, ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128));
+		}
+		fwrite("FRAME\n", 1, 6, m_File);
+		fwrite(m_Scratch.data(), 1, m_Scratch.size(), m_File);
+		break;
+	}
+	case CaptureFormat::DELTA:
+	{
+		bool first = m_Previous.empty();
+		if (first)
+			m_Previous.resize(FRAME_BYTES);
+
+		std::vector<uint32_t>& rows = m_Rows;
+		rows.clear();
+		for (int row = 0; row < HEIGHT; ++row)
+		{
+			if (first || memcmp(src + row * rowBytes, m_Previous.data() + row * rowBytes, rowBytes) != 0)
+				rows.push_back(row);
+		}
+		uint32_t header[2] = { frame.index, (uint32_t) rows.size() };
+		fwrite(header, sizeof(header), 1, m_File);
+		for (uint32_t row : rows)
+		{
+			fwrite(&row, sizeof(row), 1, m_File);
+			fwrite(src + row * rowBytes, 1, rowBytes, m_File);
+		}
+		memcpy(m_Previous.data(), src, FRAME_BYTES);
+		break;
+	}
+	}
+}
+
+};
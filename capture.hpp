@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include "upscale.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gph
+{
+
+enum class CaptureFormat
+{
+	PPM,   // concatenated binary PPM frames
+	Y4M,   // YUV4MPEG2 stream, 4:4:4 full range
+	DELTA  // "GDLT": only the rows that changed since the previous frame
+};
+
+// Records presented frames on a background thread. submit() copies the frame
+// into a pooled buffer and returns; when every buffer is still queued for the
+// writer the frame is dropped and counted instead of stalling the caller.
+// The stream size is fixed when it opens; frames of any other size (e.g. after
+// a window resize) are resampled to it with nearest filtering.
+//
+// GDLT layout: "GDLT", u32 width, u32 height, then per frame u32 frame index,
+// u32 changed row count and, for each changed row, u32 row followed by its
+// width * 4 BGRA bytes. Frame indices count dropped frames too.
+class FrameCapture
+{
+public:
+	FrameCapture(const std::string& path, int width, int height, CaptureFormat format, int poolSize = 8, int fps = 60);
+	~FrameCapture();
+
+	bool isOpen() const { return m_File != nullptr; }
+	void submit(const unsigned char* bgra, int width, int height);
+
+	uint64_t submitted() const { return m_Submitted; }
+	uint64_t dropped() const { return m_Dropped; }
+	uint64_t written() const { return m_Written; }
+
+	FrameCapture(const FrameCapture&)			 = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+protected:
+	struct Frame
+	{
+		unsigned char* pixels;
+		uint32_t	   index;
+	};
+
+	void writer();
+	void write_frame(const Frame& frame);
+
+	int			  WIDTH, HEIGHT, FRAME_BYTES;
+	CaptureFormat m_Format;
+	FILE*		  m_File;
+
+	std::vector<unsigned char*> m_Pool;
+	std::vector<unsigned char*> m_Free;
+	std::deque<Frame>			m_Queue;
+	std::mutex					m_Mutex;
+	std::condition_variable		m_Ready;
+	bool						m_Stop = false;
+	std::thread					m_Writer;
+
+	FrameArena				   m_ResizeScratch;
+	std::vector<unsigned char> m_Previous;
+	std::vector<unsigned char> m_Scratch;
+	std::vector<uint32_t>	   m_Rows;
+
+	std::atomic<uint64_t> m_Submitted { 0 };
+	std::atomic<uint64_t> m_Dropped { 0 };
+	std::atomic<uint64_t> m_Written { 0 };
+};
+
+};
@@ -0,0 +1,115 @@
+#include "drawlist.hpp"
+#include <algorithm>
+
+namespace gph
+{
+
+void DrawList::add(int z, TraceOp op, std::initializer_list<int> args, const FillStyle& fillStyle)
+{
+	if (m_Count == m_Draws.size())
+		m_Draws.emplace_back();
+	Draw& draw = m_Draws[m_Count++];
+
+	draw.call.op	= op;
+	draw.call.state = (m_Canvas.linear_blending() ? TRACE_STATE_LINEAR : 0)
+					  | (uint8_t) m_Canvas.blend_mode() << TRACE_STATE_BLEND_SHIFT;
+	draw.call.depth = 0;
+	std::copy(args.begin(), args.end(), draw.call.args);
+	draw.call.params.clear();
+	draw.call.fill = fillStyle.record(draw.call.params);
+	draw.z		   = z;
+	draw.opaque	   = Canvas::occludes(fillStyle, m_Canvas.blend_mode());
+	draw.fillStyle = draw.call.fill == FILL_UNKNOWN ? &fillStyle : nullptr;
+}
+
+void DrawList::fill_rectangle(int z, Vector2 aPos, int width, int height, const FillStyle& fillStyle)
+{
+	add(z, TRACE_RECTANGLE, { aPos.x, aPos.y, width, height }, fillStyle);
+}
+
+void DrawList::fill_line(int z, Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle)
+{
+	add(z, TRACE_LINE, { aPos1.x, aPos1.y, aPos2.x, aPos2.y }, fillStyle);
+}
+
+void DrawList::fill_circle(int z, Vector2 center, int radius, const FillStyle& fillStyle)
+{
+	add(z, TRACE_CIRCLE, { center.x, center.y, radius }, fillStyle);
+}
+
+void DrawList::fill_triangle(int z, Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle)
+{
+	add(z, TRACE_TRIANGLE, { p1.x, p1.y, p2.x, p2.y, p3.x, p3.y }, fillStyle);
+}
+
+void DrawList::fill_rectangle(int z, FixedVector2 aPos, int width, int height, const FillStyle& fillStyle)
+{
+	add(z, TRACE_RECTANGLE_FIXED, { aPos.x, aPos.y, width, height }, fillStyle);
+}
+
+void DrawList::fill_line(int z, FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle)
+{
+	add(z, TRACE_LINE_FIXED, { aPos1.x, aPos1.y, aPos2.x, aPos2.y }, fillStyle);
+}
+
+void DrawList::fill_circle(int z, FixedVector2 center, int radius, const FillStyle& fillStyle)
+{
+	add(z, TRACE_CIRCLE_FIXED, { center.x, center.y, radius }, fillStyle);
+}
+
+void DrawList::fill_triangle(int z, FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle)
+{
+	add(z, TRACE_TRIANGLE_FIXED, { p1.x, p1.y, p2.x, p2.y, p3.x, p3.y }, fillStyle);
+}
+
+void DrawList::flush()
+{
+	if (m_Count == 0)
+		return;
+
+	// Back-to-front painter's order; a draw's depth is its position in it, so
+	// a translucent draw still lands on opaque draws that came before it.
+	m_Order.resize(m_Count);
+	for (uint32_t i = 0; i < m_Count; ++i)
+		m_Order[i] = i;
+	std::sort(m_Order.begin(), m_Order.end(), [this](uint32_t a, uint32_t b) {
+		return m_Draws[a].z != m_Draws[b].z ? m_Draws[a].z < m_Draws[b].z : a < b;
+	});
+	uint32_t first = m_Canvas.reserve_depth((uint32_t) m_Count);
+	for (uint32_t i = 0; i < m_Count; ++i)
+		m_Draws[m_Order[i]].call.depth = first + i;
+
+	BlendMode mode	 = m_Canvas.blend_mode();
+	bool	  linear = m_Canvas.linear_blending();
+	uint32_t  depth	 = m_Canvas.depth();
+
+	auto issue = [this](const Draw& draw) {
+		if (draw.fillStyle)
+		{
+			m_Canvas.set_linear_blending(draw.call.state & TRACE_STATE_LINEAR);
+			m_Canvas.set_blend_mode(
+				(BlendMode) ((draw.call.state & TRACE_STATE_BLEND_MASK) >> TRACE_STATE_BLEND_SHIFT));
+			m_Canvas.set_depth(draw.call.depth);
+			draw.call.execute_with(m_Canvas, *draw.fillStyle);
+		}
+		else
+			draw.call.execute(m_Canvas);
+	};
+	for (size_t i = m_Count; i-- > 0;)
+	{
+		if (m_Draws[m_Order[i]].opaque)
+			issue(m_Draws[m_Order[i]]);
+	}
+	for (size_t i = 0; i < m_Count; ++i)
+	{
+		if (!m_Draws[m_Order[i]].opaque)
+			issue(m_Draws[m_Order[i]]);
+	}
+
+	m_Canvas.set_blend_mode(mode);
+	m_Canvas.set_linear_blending(linear);
+	m_Canvas.set_depth(depth);
+	m_Count = 0;
+}
+
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "trace.hpp"
+
+namespace gph
+{
+
+// Defers a frame's shape draws so they can be issued by depth. flush() draws
+// the opaque ones front to back, so the pixels they cover are rejected before
+// a farther draw's FillStyle runs, then the translucent ones back to front.
+// Larger z is nearer and equal z keeps submission order. The canvas blend
+// state is captured per draw. Solid and radial gradient fills are copied;
+// any other FillStyle must stay alive until flush().
+class DrawList
+{
+public:
+	explicit DrawList(Canvas& canvas)
+	: m_Canvas(canvas)
+	{
+	}
+
+	void fill_rectangle(int z, Vector2 aPos, int width, int height, const FillStyle& fillStyle);
+	void fill_line(int z, Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle);
+	void fill_circle(int z, Vector2 center, int radius, const FillStyle& fillStyle);
+	void fill_triangle(int z, Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle);
+
+	void fill_rectangle(int z, FixedVector2 aPos, int width, int height, const FillStyle& fillStyle);
+	void fill_line(int z, FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle);
+	void fill_circle(int z, FixedVector2 center, int radius, const FillStyle& fillStyle);
+	void fill_triangle(int z, FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle);
+
+	// Draws everything queued since the last flush and empties the list.
+	void   flush();
+	size_t size() const { return m_Count; }
+
+protected:
+	struct Draw
+	{
+		TraceCall		 call;
+		int				 z;
+		bool			 opaque;
+		const FillStyle* fillStyle;
+	};
+
+	void add(int z, TraceOp op, std::initializer_list<int> args, const FillStyle& fillStyle);
+
+	Canvas& m_Canvas;
+	// Slots are reused across frames so their params keep their capacity.
+	std::vector<Draw>	  m_Draws;
+	size_t				  m_Count = 0;
+	std::vector<uint32_t> m_Order;
+};
+
+};
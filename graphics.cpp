@@ -1,118 +1,76 @@
 #include "graphics.hpp"
+#include "trace.hpp"
 
 namespace gph
 {
 
-GWindow::GWindow(int width, int height, std::string title)
+Canvas::Canvas(int width, int height, bool hugePages)
 : WINDOW_WIDTH(width)
 , WINDOW_HEIGHT(height)
-, WINDOW_TITLE(title)
-, program_start_clock(std::chrono::high_resolution_clock::now())
+, m_HugePages(hugePages)
 {
-	WINDOW_PIXEL = 4 * WINDOW_HEIGHT * WINDOW_WIDTH;
-
-	m_Display = XOpenDisplay(NIL);
-	assert(m_Display);
-
-	elapsed_time	= std::chrono::high_resolution_clock::now() - program_start_clock;
-	double_timestep = (sin(elapsed_time.count()) + 1) / 2.0;
-
-	screenbuffer = (unsigned char*) malloc(WINDOW_PIXEL);
-	memset(screenbuffer, 255, 4 * WINDOW_HEIGHT * WINDOW_WIDTH);
-
-	int blackColor = BlackPixel(m_Display, DefaultScreen(m_Display));
-	int whiteColor = WhitePixel(m_Display, DefaultScreen(m_Display));
-
-	m_Window = XCreateSimpleWindow(m_Display,
-								   DefaultRootWindow(m_Display),
-								   0,
-								   0,
-								   WINDOW_WIDTH,
-								   WINDOW_HEIGHT,
-								   0,
-								   blackColor,
-								   blackColor);
-
-	XSelectInput(m_Display, m_Window, StructureNotifyMask | ExposureMask | KeyPressMask);
-
-	XMapWindow(m_Display, m_Window);
-
-	m_Graphics = XCreateGC(m_Display, m_Window, 0, NIL);
-	m_Visual   = DefaultVisual(m_Display, DefaultScreen(m_Display));
-
-	m_Image = create_ximage(m_Display, m_Visual, WINDOW_WIDTH, WINDOW_HEIGHT);
-	memcpy(m_Image->data, screenbuffer, WINDOW_PIXEL);
+	WINDOW_PIXEL = BYTES_PER_PIXEL * WINDOW_HEIGHT * WINDOW_WIDTH;
+	screenbuffer = (unsigned char*) m_Pool.acquire(WINDOW_PIXEL, m_HugePages);
+	memset(screenbuffer, 255, WINDOW_PIXEL);
+}
 
-	bool drawMode = false;
+Canvas::~Canvas()
+{
+	free_surface(screenbuffer);
+	free_surface(m_DepthBuffer);
+}
 
-	Start();
+void Canvas::resize(int width, int height)
+{
+	if (width == WINDOW_WIDTH && height == WINDOW_HEIGHT)
+		return;
+	bool depth = m_DepthBuffer != nullptr;
+	m_Pool.release(screenbuffer);
+	m_Pool.release(m_DepthBuffer);
+	m_DepthBuffer = nullptr;
+	WINDOW_WIDTH  = width;
+	WINDOW_HEIGHT = height;
+	WINDOW_PIXEL  = BYTES_PER_PIXEL * WINDOW_HEIGHT * WINDOW_WIDTH;
+	screenbuffer  = (unsigned char*) m_Pool.acquire(WINDOW_PIXEL, m_HugePages);
+	if (depth)
+		m_DepthBuffer = (uint32_t*) m_Pool.acquire(depth_bytes(), m_HugePages);
+	clear();
+}
 
-	for (;;)
+void Canvas::set_depth(uint32_t depth)
+{
+	m_Depth = depth;
+	if (depth != 0 && m_DepthBuffer == nullptr)
 	{
-		while (XPending(m_Display))
-		{
-			XNextEvent(m_Display, &m_Event);
-		}
-		if (m_Event.type == MapNotify)
-		{
-			drawMode = true;
-		}
-		if (drawMode)
-		{
-			if (m_Event.type == Expose)
-			{
-				memcpy(m_Image->data, screenbuffer, WINDOW_PIXEL);
-				memset(screenbuffer, 255, WINDOW_PIXEL);
-
-				Update();
-
-				XPutImage(m_Display,
-						  m_Window,
-						  m_Graphics,
-						  m_Image,
-						  0,
-						  0,
-						  0,
-						  0,
-						  WINDOW_WIDTH,
-						  WINDOW_HEIGHT);
-			}
-		}
-
-		if (m_Event.type == KeyPress)
-		{
-			break;
-		}
-
-		elapsed_time	= std::chrono::high_resolution_clock::now() - program_start_clock;
-		double_timestep = (sin(elapsed_time.count()) + 1) / 2.0;
-		Tick();
+		m_DepthBuffer = (uint32_t*) m_Pool.acquire(depth_bytes(), m_HugePages);
+		clear_depth();
 	}
+	m_DepthReserved = std::max(m_DepthReserved, depth);
+}
 
-	XCloseDisplay(m_Display);
-	XDestroyWindow(m_Display, m_Window);
-	XDestroyImage(m_Image);
-	free(screenbuffer);
-};
+uint32_t Canvas::reserve_depth(uint32_t count)
+{
+	uint32_t first = m_DepthReserved + 1;
+	m_DepthReserved += count;
+	return first;
+}
 
-GWindow::~GWindow() { Close(); }
+void Canvas::clear_depth()
+{
+	if (m_DepthBuffer)
+		memset(m_DepthBuffer, 0, depth_bytes());
+	m_DepthReserved = 0;
+}
 
-XImage* GWindow::create_ximage(Display* display, Visual* visual, int width, int height)
+void Canvas::set_scale(int scale)
 {
-	unsigned char* image32 = (unsigned char*) malloc(width * height * BYTES_PER_PIXEL);
-	if (image32 == nullptr)
-	{
-		std::cout << "Image32 malloc fatal error!" << std::endl;
-		exit(1);
-	}
-	set_screen(image32, width, height);
-	return XCreateImage(display, visual, 24, ZPixmap, 0, (char*) image32, width, height, 32, 0);
+	m_Scale	   = std::max(scale, 1);
+	m_InvScale = ((int64_t) FIXED_ONE << 16) / m_Scale;
 }
 
-void GWindow::set_screen(unsigned char* rgb_out, int w, int h)
+uint8_t Canvas::trace_state() const
 {
-	std::strncpy((char*) rgb_out, (const char*) screenbuffer, w * h * BYTES_PER_PIXEL);
-	return;
+	return (m_LinearBlending ? TRACE_STATE_LINEAR : 0) | (uint8_t) m_BlendMode << TRACE_STATE_BLEND_SHIFT;
 }
 
 int get_buffer_index(Vector2 pos, int WINDOW_WIDTH) { return (pos.y * WINDOW_WIDTH + pos.x) * 4; }
@@ -146,6 +104,39 @@ Color lerpRGB(Color c1, Color c2, float time)
 	return r;
 }
 
+uint16_t SRGB_TO_LINEAR[256];
+uint8_t	 LINEAR_TO_SRGB[LINEAR_MAX + 1];
+
+static struct GammaTables
+{
+	GammaTables()
+	{
+		for (int i = 0; i < 256; ++i)
+		{
+			double c		  = i / 255.0;
+			double l		  = c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+			SRGB_TO_LINEAR[i] = (uint16_t) lround(l * LINEAR_MAX);
+		}
+		for (int i = 0; i <= LINEAR_MAX; ++i)
+		{
+			double l		  = (double) i / LINEAR_MAX;
+			double c		  = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1 / 2.4) - 0.055;
+			LINEAR_TO_SRGB[i] = (uint8_t) lround(c * 255);
+		}
+	}
+} gammaTables;
+
+Color lerpRGB_linear(Color c1, Color c2, float time)
+{
+	int t = (int) (time * 256 + 0.5f);
+	int s = 256 - t;
+	Color r(linear_to_srgb((srgb_to_linear(c1.r) * s + srgb_to_linear(c2.r) * t) >> 8),
+			linear_to_srgb((srgb_to_linear(c1.g) * s + srgb_to_linear(c2.g) * t) >> 8),
+			linear_to_srgb((srgb_to_linear(c1.b) * s + srgb_to_linear(c2.b) * t) >> 8),
+			(c1.a * s + c2.a * t) >> 8);
+	return r;
+}
+
 float lerp(float a, float b, float time, bool looping)
 {
 	return (looping) ? ((a * (1.0 - fmod(time, 1.0f))) + (b * fmod(time, 1.0f)))
@@ -168,7 +159,7 @@ bool point_in_triangle(Vector2 aPoint, Vector2 t1, Vector2 t2, Vector2 t3)
 	return (a == a1 + a2 + a3);
 }
 
-void GWindow::fill_pixel(Vector2 aPos, Color aColor)
+void Canvas::fill_pixel(Vector2 aPos, Color aColor)
 {
 	if ((aPos.x < 0 || aPos.x > WINDOW_WIDTH) || (aPos.y < 0 || aPos.y > WINDOW_HEIGHT))
 		return;
@@ -180,30 +171,222 @@ void GWindow::fill_pixel(Vector2 aPos, Color aColor)
 	return;
 }
 
-void GWindow::blend_pixel(Vector2 aPos, Color aColor)
+void Canvas::blend_pixel(Vector2 aPos, Color aColor)
 {
-	Color dst	  = get_buffer_pixel_color(aPos, WINDOW_WIDTH, screenbuffer);
-	Color blended = lerpRGB(dst, aColor, (float) aColor.a / 255);
-	fill_pixel(aPos, blended);
+	if ((aPos.x < 0 || aPos.x >= WINDOW_WIDTH) || (aPos.y < 0 || aPos.y >= WINDOW_HEIGHT))
+		return;
+	unsigned char* p   = screenbuffer + get_buffer_index(aPos, WINDOW_WIDTH);
+	Color		   dst = Color(p[2], p[1], p[0], p[3]);
+	fill_pixel(aPos, blend_reference(m_BlendMode, aColor, dst, m_LinearBlending));
 	return;
 }
 
-void GWindow::fill_rectangle(Vector2 aPos, int width, int height, const FillStyle& fillStyle)
+Color blend_reference(BlendMode mode, Color src, Color dst, bool linear)
 {
-	for (int y1 = aPos.y; y1 < aPos.y + height; ++y1)
+	src = clamp_color(src);
+
+	int a		= src.a;
+	int max		= linear ? LINEAR_MAX : 255;
+	int s[3]	= { src.r, src.g, src.b };
+	int d[3]	= { dst.r, dst.g, dst.b };
+	int out[3]	= {};
+	for (int i = 0; i < 3; ++i)
 	{
-		for (int x1 = aPos.x; x1 < aPos.x + width; x1++)
+		int sc = linear ? srgb_to_linear(s[i]) : s[i];
+		int dc = linear ? srgb_to_linear(d[i]) : d[i];
+		int v  = 0;
+		switch (mode)
+		{
+		case BlendMode::SrcOver: v = (sc * a + dc * (255 - a) + 127) / 255; break;
+		case BlendMode::Copy: v = sc; break;
+		case BlendMode::Add: v = std::min(dc + (sc * a + 127) / 255, max); break;
+		case BlendMode::Multiply:
+		{
+			int f = (sc * dc + max / 2) / max;
+			v	  = (f * a + dc * (255 - a) + 127) / 255;
+			break;
+		}
+		case BlendMode::Screen:
+		{
+			int f = sc + dc - (sc * dc + max / 2) / max;
+			v	  = (f * a + dc * (255 - a) + 127) / 255;
+			break;
+		}
+		case BlendMode::Darken: v = (std::min(sc, dc) * a + dc * (255 - a) + 127) / 255; break;
+		case BlendMode::Lighten: v = (std::max(sc, dc) * a + dc * (255 - a) + 127) / 255; break;
+		default: v = dc; break;
+		}
+		out[i] = linear ? linear_to_srgb(v) : v;
+	}
+	int alpha = mode == BlendMode::Copy ? a : (a * a + dst.a * (255 - a) + 127) / 255;
+	return Color(out[0], out[1], out[2], alpha);
+}
+
+// One color channel of blend mode M; s and d range over 0..MAX, a over 0..255.
+template <BlendMode M, int MAX> static inline int blend_channel(int s, int d, int a)
+{
+	if (M == BlendMode::Copy)
+		return s;
+	if (M == BlendMode::Add)
+		return std::min(d + (s * a + 127) / 255, MAX);
+
+	int f = s;
+	if (M == BlendMode::Multiply)
+		f = (s * d + MAX / 2) / MAX;
+	else if (M == BlendMode::Screen)
+		f = s + d - (s * d + MAX / 2) / MAX;
+	else if (M == BlendMode::Darken)
+		f = std::min(s, d);
+	else if (M == BlendMode::Lighten)
+		f = std::max(s, d);
+	return (f * a + d * (255 - a) + 127) / 255;
+}
+
+template <BlendMode M, bool Linear, bool Solid>
+void Canvas::span_kernel(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid)
+{
+	unsigned char* p = canvas.screenbuffer + ((size_t) y * canvas.WINDOW_WIDTH + x0) * 4;
+
+	// Opaque solid spans that replace the destination are a plain store.
+	if (Solid && !Linear && (M == BlendMode::Copy || (M == BlendMode::SrcOver && solid.a == 255)))
+	{
+		uint32_t  pixel = solid.b | solid.g << 8 | solid.r << 16 | (uint32_t) solid.a << 24;
+		uint32_t* out	= (uint32_t*) p;
+		for (int x = x0; x < x1; ++x)
+			*out++ = pixel;
+		return;
+	}
+
+	for (int x = x0; x < x1; ++x, p += 4)
+	{
+		Color c = Solid ? solid : clamp_color(fillStyle(canvas.logical(x, y)));
+		int	  a = c.a;
+		if (Linear)
+		{
+			p[0] = linear_to_srgb(blend_channel<M, LINEAR_MAX>(srgb_to_linear(c.b), srgb_to_linear(p[0]), a));
+			p[1] = linear_to_srgb(blend_channel<M, LINEAR_MAX>(srgb_to_linear(c.g), srgb_to_linear(p[1]), a));
+			p[2] = linear_to_srgb(blend_channel<M, LINEAR_MAX>(srgb_to_linear(c.r), srgb_to_linear(p[2]), a));
+		}
+		else
+		{
+			p[0] = blend_channel<M, 255>(c.b, p[0], a);
+			p[1] = blend_channel<M, 255>(c.g, p[1], a);
+			p[2] = blend_channel<M, 255>(c.r, p[2], a);
+		}
+		p[3] = M == BlendMode::Copy ? a : (a * a + p[3] * (255 - a) + 127) / 255;
+	}
+}
+
+template <bool Premultiplied>
+void Canvas::span_image(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid)
+{
+	Vector2		   origin;
+	const Surface* surface = fillStyle.image(origin);
+	int			   sy	   = y - origin.y;
+	if (sy < 0 || sy >= surface->height)
+		return;
+	x0 = std::max(x0, origin.x);
+	x1 = std::min(x1, origin.x + surface->width);
+
+	const unsigned char* q = surface->pixels + (size_t) sy * surface->stride + (size_t) (x0 - origin.x) * 4;
+	unsigned char*		 p = canvas.screenbuffer + ((size_t) y * canvas.WINDOW_WIDTH + x0) * 4;
+	for (int x = x0; x < x1; ++x, p += 4, q += 4)
+	{
+		int a = q[3];
+		if (a == 255)
+		{
+			memcpy(p, q, 4);
+			continue;
+		}
+		if (a == 0)
+			continue;
+		for (int i = 0; i < 3; ++i)
 		{
-			Color color = fillStyle({ x1, y1 });
-			blend_pixel({ x1, y1 }, color);
+			if (Premultiplied)
+				p[i] = std::min(q[i] + (p[i] * (255 - a) + 127) / 255, 255);
+			else
+				p[i] = blend_channel<BlendMode::SrcOver, 255>(q[i], p[i], a);
 		}
+		p[3] = (a * a + p[3] * (255 - a) + 127) / 255;
+	}
+}
+
+void Canvas::span_reference(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid)
+{
+	for (int x = x0; x < x1; ++x)
+		canvas.blend_pixel({ x, y }, fillStyle(canvas.logical(x, y)));
+}
+
+#define BLEND_KERNELS(M)                                                                          \
+	{                                                                                             \
+		{ &Canvas::span_kernel<M, false, false>, &Canvas::span_kernel<M, false, true> },          \
+		{                                                                                         \
+			&Canvas::span_kernel<M, true, false>, &Canvas::span_kernel<M, true, true>             \
+		}                                                                                         \
+	}
+
+Canvas::SpanWriter Canvas::span_writer(const FillStyle& fillStyle)
+{
+	// Indexed by blend mode, linear blending and whether the fill is solid.
+	static const SpanFn kernels[(int) BlendMode::COUNT][2][2] = {
+		BLEND_KERNELS(BlendMode::SrcOver), BLEND_KERNELS(BlendMode::Copy),	 BLEND_KERNELS(BlendMode::Add),
+		BLEND_KERNELS(BlendMode::Multiply), BLEND_KERNELS(BlendMode::Screen), BLEND_KERNELS(BlendMode::Darken),
+		BLEND_KERNELS(BlendMode::Lighten)
+	};
+
+	Color	  solid;
+	bool	  isSolid	  = fillStyle.solid_color(solid);
+	uint32_t* depthBuffer = m_Depth != 0 ? m_DepthBuffer : nullptr;
+	bool	  writeDepth  = depthBuffer != nullptr && occludes(fillStyle, m_BlendMode);
+	SpanFn	  kernel	  = kernels[(int) m_BlendMode][m_LinearBlending][isSolid];
+	Vector2		   origin;
+	const Surface* image = fillStyle.image(origin);
+	if (image && m_BlendMode == BlendMode::SrcOver && !m_LinearBlending && m_Scale == FIXED_ONE)
+		kernel = image->premultiplied ? &Canvas::span_image<true> : &Canvas::span_image<false>;
+	if (m_ReferenceBlending)
+		kernel = &Canvas::span_reference;
+	return SpanWriter { *this, kernel, fillStyle, clamp_color(solid), depthBuffer, m_Depth, writeDepth };
+}
+
+#undef BLEND_KERNELS
+
+void Canvas::fill_rectangle(Vector2 aPos, int width, int height, const FillStyle& fillStyle)
+{
+	if (m_Trace)
+		m_Trace->record(TRACE_RECTANGLE,
+						trace_state(),
+						m_Depth,
+						{ aPos.x, aPos.y, width, height },
+						fillStyle);
+	if (m_Scale != FIXED_ONE)
+		return raster_rectangle(to_buffer(FixedVector2::from_pixel(aPos)),
+								to_buffer(to_fixed(width)),
+								to_buffer(to_fixed(height)),
+								fillStyle);
+
+	SpanWriter span = span_writer(fillStyle);
+	for (int y1 = aPos.y; y1 < aPos.y + height; ++y1)
+	{
+		span(y1, aPos.x, aPos.x + width);
 	}
 	return;
 }
 
-void GWindow::fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle)
+void Canvas::fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle)
 {
-	bool yLonger = false;
+	if (m_Trace)
+		m_Trace->record(TRACE_LINE,
+						trace_state(),
+						m_Depth,
+						{ aPos1.x, aPos1.y, aPos2.x, aPos2.y },
+						fillStyle);
+	if (m_Scale != FIXED_ONE)
+		return raster_line(to_buffer(FixedVector2::from_pixel(aPos1)),
+						   to_buffer(FixedVector2::from_pixel(aPos2)),
+						   fillStyle);
+
+	SpanWriter span	   = span_writer(fillStyle);
+	bool	   yLonger = false;
 	int	 incrementVal, endVal;
 	int	 shortLen = aPos2.y - aPos1.y;
 	int	 longLen  = aPos2.x - aPos1.x;
@@ -232,8 +415,7 @@ void GWindow::fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle
 	{
 		for (int i = 0; i != endVal; i += incrementVal)
 		{
-			Color color = fillStyle({ aPos1.x + (j >> 16), aPos1.y + i });
-			blend_pixel({ aPos1.x + (j >> 16), aPos1.y + i }, color);
+			span(aPos1.y + i, aPos1.x + (j >> 16), aPos1.x + (j >> 16) + 1);
 			j += decInc;
 		}
 	}
@@ -241,52 +423,309 @@ void GWindow::fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle
 	{
 		for (int i = 0; i != endVal; i += incrementVal)
 		{
-			Color color = fillStyle({ aPos1.x + i, aPos1.y + (j >> 16) });
-			fill_pixel({ aPos1.x + i, aPos1.y + (j >> 16) }, color);
-
+			span(aPos1.y + (j >> 16), aPos1.x + i, aPos1.x + i + 1);
 			j += decInc;
 		}
 	}
 	return;
 }
 
-void GWindow::fill_circle(Vector2 center, int radius, const FillStyle& fillStyle)
+void Canvas::fill_circle(Vector2 center, int radius, const FillStyle& fillStyle)
 {
-	float x1 = float(center.x) - radius, y1 = float(center.y) - radius;
-	float x2 = float(center.x) + radius, y2 = float(center.y) + radius;
+	if (m_Trace)
+		m_Trace->record(TRACE_CIRCLE,
+						trace_state(),
+						m_Depth,
+						{ center.x, center.y, radius },
+						fillStyle);
+	if (m_Scale != FIXED_ONE)
+		return raster_circle(to_buffer(FixedVector2::from_pixel(center)), to_buffer(to_fixed(radius)), fillStyle);
+
+	SpanWriter span = span_writer(fillStyle);
+	float	   x1 = float(center.x) - radius, y1 = float(center.y) - radius;
+	float	   x2 = float(center.x) + radius, y2 = float(center.y) + radius;
 	for (int y = y1; y < y2; ++y)
 	{
-		for (int x = x1; x < x2; ++x)
+		int runStart = -1;
+		int x		 = x1;
+		for (; x < x2; ++x)
 		{
 			float distX = (x - center.x + 0.5), distY = (y - center.y + 0.5);
 			float distance = sqrt(distX * distX + distY * distY);
 			if (distance <= radius)
 			{
-				Color color = fillStyle({ x, y });
-				blend_pixel({ x, y }, color);
+				if (runStart < 0)
+					runStart = x;
+			}
+			else if (runStart >= 0)
+			{
+				span(y, runStart, x);
+				runStart = -1;
 			}
 		}
+		if (runStart >= 0)
+			span(y, runStart, x);
 	}
 	return;
 }
 
-void GWindow::fill_triangle(Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle)
+void Canvas::fill_triangle(Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle)
 {
+	if (m_Trace)
+		m_Trace->record(TRACE_TRIANGLE,
+						trace_state(),
+						m_Depth,
+						{ p1.x, p1.y, p2.x, p2.y, p3.x, p3.y },
+						fillStyle);
+	if (m_Scale != FIXED_ONE)
+		return raster_triangle(to_buffer(FixedVector2::from_pixel(p1)),
+							   to_buffer(FixedVector2::from_pixel(p2)),
+							   to_buffer(FixedVector2::from_pixel(p3)),
+							   fillStyle);
+
 	int maxX = std::max(p1.x, std::max(p2.x, p3.x));
 	int minX = std::min(p1.x, std::min(p2.x, p3.x));
 	int maxY = std::max(p1.y, std::max(p2.y, p3.y));
 	int minY = std::min(p1.y, std::min(p2.y, p3.y));
 
-	for (int x = minX; x <= maxX; ++x)
+	SpanWriter span = span_writer(fillStyle);
+	for (int y = minY; y <= maxY; ++y)
 	{
-		for (int y = minY; y <= maxY; ++y)
+		int runStart = -1;
+		for (int x = minX; x <= maxX; ++x)
 		{
 			if (point_in_triangle({ x, y }, p1, p2, p3))
 			{
-				Color color = fillStyle({ x, y });
-				blend_pixel({ x, y }, color);
+				if (runStart < 0)
+					runStart = x;
+			}
+			else if (runStart >= 0)
+			{
+				span(y, runStart, x);
+				runStart = -1;
 			}
 		}
+		if (runStart >= 0)
+			span(y, runStart, maxX + 1);
+	}
+	return;
+}
+
+// Center of pixel p in 24.8 fixed-point.
+static int pixel_center(int p) { return p * FIXED_ONE + FIXED_HALF; }
+
+void Canvas::fill_rectangle(FixedVector2 aPos, int width, int height, const FillStyle& fillStyle)
+{
+	if (m_Trace)
+		m_Trace->record(TRACE_RECTANGLE_FIXED,
+						trace_state(),
+						m_Depth,
+						{ aPos.x, aPos.y, width, height },
+						fillStyle);
+	raster_rectangle(to_buffer(aPos), to_buffer(width), to_buffer(height), fillStyle);
+}
+
+void Canvas::fill_line(FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle)
+{
+	if (m_Trace)
+		m_Trace->record(TRACE_LINE_FIXED,
+						trace_state(),
+						m_Depth,
+						{ aPos1.x, aPos1.y, aPos2.x, aPos2.y },
+						fillStyle);
+	raster_line(to_buffer(aPos1), to_buffer(aPos2), fillStyle);
+}
+
+void Canvas::fill_circle(FixedVector2 center, int radius, const FillStyle& fillStyle)
+{
+	if (m_Trace)
+		m_Trace->record(TRACE_CIRCLE_FIXED,
+						trace_state(),
+						m_Depth,
+						{ center.x, center.y, radius },
+						fillStyle);
+	raster_circle(to_buffer(center), to_buffer(radius), fillStyle);
+}
+
+void Canvas::fill_triangle(FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle)
+{
+	if (m_Trace)
+		m_Trace->record(TRACE_TRIANGLE_FIXED,
+						trace_state(),
+						m_Depth,
+						{ p1.x, p1.y, p2.x, p2.y, p3.x, p3.y },
+						fillStyle);
+	raster_triangle(to_buffer(p1), to_buffer(p2), to_buffer(p3), fillStyle);
+}
+
+void Canvas::raster_rectangle(FixedVector2 aPos, int width, int height, const FillStyle& fillStyle)
+{
+	int x0 = std::max(fixed_ceil(aPos.x - FIXED_HALF), 0);
+	int y0 = std::max(fixed_ceil(aPos.y - FIXED_HALF), 0);
+	int x1 = std::min(fixed_ceil(aPos.x + width - FIXED_HALF), WINDOW_WIDTH);
+	int y1 = std::min(fixed_ceil(aPos.y + height - FIXED_HALF), WINDOW_HEIGHT);
+
+	SpanWriter span = span_writer(fillStyle);
+	for (int y = y0; y < y1; ++y)
+		span(y, x0, x1);
+	return;
+}
+
+void Canvas::raster_line(FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle)
+{
+	int	 dx		 = aPos2.x - aPos1.x;
+	int	 dy		 = aPos2.y - aPos1.y;
+	bool yLonger = abs(dy) > abs(dx);
+	if (yLonger)
+	{
+		std::swap(aPos1.x, aPos1.y);
+		std::swap(aPos2.x, aPos2.y);
+		std::swap(dx, dy);
+	}
+	if (dx < 0)
+	{
+		std::swap(aPos1, aPos2);
+		dx = -dx;
+		dy = -dy;
+	}
+	if (dx == 0)
+		return;
+
+	// Step the major axis through pixel centers and carry the minor axis as a
+	// 16.16 fraction of a 24.8 coordinate.
+	int		start = fixed_ceil(aPos1.x - FIXED_HALF);
+	int		end	  = fixed_ceil(aPos2.x - FIXED_HALF);
+	int64_t slope = (int64_t) dy * 65536 / dx;
+	int64_t minor = (int64_t) aPos1.y * 65536 + (pixel_center(start) - aPos1.x) * slope;
+	int64_t step  = slope * FIXED_ONE;
+
+	SpanWriter span = span_writer(fillStyle);
+	for (int i = start; i < end; ++i, minor += step)
+	{
+		int j = (int) (minor >> (16 + FIXED_SHIFT));
+		if (yLonger)
+			span(i, j, j + 1);
+		else
+			span(j, i, i + 1);
+	}
+	return;
+}
+
+// floor(sqrt(n)) by integer Newton iteration from guess. One step from any
+// positive guess lands at or above the root, and from there the steps
+// decrease monotonically onto it.
+static int64_t isqrt(int64_t n, int64_t guess)
+{
+	if (n < 2)
+		return n;
+	int64_t x = std::max<int64_t>(guess, 1);
+	int64_t y = (x + n / x) / 2;
+	do
+	{
+		x = y;
+		y = (x + n / x) / 2;
+	} while (y < x);
+	return x;
+}
+
+void Canvas::raster_circle(FixedVector2 center, int radius, const FillStyle& fillStyle)
+{
+	int x0 = std::max(fixed_ceil(center.x - radius - FIXED_HALF), 0);
+	int y0 = std::max(fixed_ceil(center.y - radius - FIXED_HALF), 0);
+	int x1 = std::min(fixed_floor(center.x + radius - FIXED_HALF) + 1, WINDOW_WIDTH);
+	int y1 = std::min(fixed_floor(center.y + radius - FIXED_HALF) + 1, WINDOW_HEIGHT);
+
+	// Per row, the covered centers are those within the integer square root of
+	// the remaining squared radius, so each row is a single span. The root is
+	// seeded with the previous row's, so it takes a few Newton steps per row.
+	SpanWriter span	   = span_writer(fillStyle);
+	int64_t	   radius2 = (int64_t) radius * radius;
+	int64_t	   d	   = radius;
+	for (int y = y0; y < y1; ++y)
+	{
+		int64_t distY = pixel_center(y) - center.y;
+		int64_t rest  = radius2 - distY * distY;
+		if (rest < 0)
+			continue;
+		d = isqrt(rest, d);
+		int left  = fixed_ceil(center.x - (int) d - FIXED_HALF);
+		int right = fixed_floor(center.x + (int) d - FIXED_HALF) + 1;
+		span(y, std::max(left, x0), std::min(right, x1));
+	}
+	return;
+}
+
+static int64_t edge_function(FixedVector2 a, FixedVector2 b, int64_t px, int64_t py)
+{
+	return (int64_t) (b.x - a.x) * (py - a.y) - (int64_t) (b.y - a.y) * (px - a.x);
+}
+
+// Top-left fill rule: pixels exactly on a shared edge belong to one triangle only.
+static int64_t edge_bias(FixedVector2 a, FixedVector2 b)
+{
+	int	 dx		 = b.x - a.x;
+	int	 dy		 = b.y - a.y;
+	bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+	return topLeft ? 0 : -1;
+}
+
+// Narrows [xs, xe) to the pixels where an edge function that is w at minX and
+// grows by step per pixel stays non-negative.
+static void clip_edge_span(int64_t w, int64_t step, int minX, int& xs, int& xe)
+{
+	if (step == 0)
+	{
+		if (w < 0)
+			xe = xs;
+	}
+	else if (step > 0)
+	{
+		if (w < 0)
+			xs = (int) std::max<int64_t>(xs, std::min<int64_t>(minX + (-w + step - 1) / step, xe));
+	}
+	else if (w < 0)
+		xe = xs;
+	else
+		xe = (int) std::min<int64_t>(xe, minX + w / -step + 1);
+}
+
+void Canvas::raster_triangle(FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle)
+{
+	int64_t area = edge_function(p1, p2, p3.x, p3.y);
+	if (area == 0)
+		return;
+	if (area < 0)
+		std::swap(p2, p3);
+
+	int minX = std::max(fixed_floor(std::min(p1.x, std::min(p2.x, p3.x))), 0);
+	int minY = std::max(fixed_floor(std::min(p1.y, std::min(p2.y, p3.y))), 0);
+	int maxX = std::min(fixed_ceil(std::max(p1.x, std::max(p2.x, p3.x))), WINDOW_WIDTH);
+	int maxY = std::min(fixed_ceil(std::max(p1.y, std::max(p2.y, p3.y))), WINDOW_HEIGHT);
+	if (minX >= maxX || minY >= maxY)
+		return;
+
+	// Edge functions at the first pixel center, then stepped incrementally.
+	int64_t cx	 = pixel_center(minX);
+	int64_t cy	 = pixel_center(minY);
+	int64_t row1 = edge_function(p2, p3, cx, cy) + edge_bias(p2, p3);
+	int64_t row2 = edge_function(p3, p1, cx, cy) + edge_bias(p3, p1);
+	int64_t row3 = edge_function(p1, p2, cx, cy) + edge_bias(p1, p2);
+
+	int64_t stepX1 = -(int64_t) (p3.y - p2.y) * FIXED_ONE, stepY1 = (int64_t) (p3.x - p2.x) * FIXED_ONE;
+	int64_t stepX2 = -(int64_t) (p1.y - p3.y) * FIXED_ONE, stepY2 = (int64_t) (p1.x - p3.x) * FIXED_ONE;
+	int64_t stepX3 = -(int64_t) (p2.y - p1.y) * FIXED_ONE, stepY3 = (int64_t) (p2.x - p1.x) * FIXED_ONE;
+
+	SpanWriter span = span_writer(fillStyle);
+	for (int y = minY; y < maxY; ++y)
+	{
+		int xs = minX, xe = maxX;
+		clip_edge_span(row1, stepX1, minX, xs, xe);
+		clip_edge_span(row2, stepX2, minX, xs, xe);
+		clip_edge_span(row3, stepX3, minX, xs, xe);
+		span(y, xs, xe);
+		row1 += stepY1;
+		row2 += stepY2;
+		row3 += stepY3;
 	}
 	return;
 }
@@ -1,6 +1,9 @@
+#pragma once
+
 #include <X11/X.h>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -9,12 +12,20 @@
 #include <assert.h>
 #include <unistd.h>
 #include <chrono>
+#include <initializer_list>
+#include <vector>
+
+#include "arena.hpp"
+#include "upscale.hpp"
 
 #define NIL (0)
 
 namespace gph
 {
 
+class FrameCapture;
+class TraceRecorder;
+
 struct Color
 {
 	int r, g, b, a;
@@ -25,6 +36,15 @@ struct Color
 	, a(_a){};
 };
 
+// Color with every channel clamped to 0..255, as blending sees it.
+inline Color clamp_color(Color c)
+{
+	return Color(std::min(std::max(c.r, 0), 255),
+				 std::min(std::max(c.g, 0), 255),
+				 std::min(std::max(c.b, 0), 255),
+				 std::min(std::max(c.a, 0), 255));
+}
+
 struct Vector2
 {
 	int x, y;
@@ -33,20 +53,110 @@ struct Vector2
 	, y(_y){};
 };
 
+// 24.8 fixed-point: the low FIXED_SHIFT bits of a coordinate are the sub-pixel part.
+const int FIXED_SHIFT = 8;
+const int FIXED_ONE	  = 1 << FIXED_SHIFT;
+const int FIXED_HALF  = FIXED_ONE >> 1;
+
+inline int to_fixed(int v) { return v * FIXED_ONE; }
+inline int to_fixed(double v) { return (int) lround(v * FIXED_ONE); }
+inline int fixed_floor(int v) { return v >> FIXED_SHIFT; }
+inline int fixed_ceil(int v) { return (v + FIXED_ONE - 1) >> FIXED_SHIFT; }
+
+// Sub-pixel position. There is deliberately no (int, int) constructor so that
+// braced {x, y} arguments keep resolving to the Vector2 fast paths.
+struct FixedVector2
+{
+	int x, y;
+	FixedVector2()
+	: x(0)
+	, y(0){};
+	static FixedVector2 from_raw(int _x, int _y)
+	{
+		FixedVector2 r;
+		r.x = _x;
+		r.y = _y;
+		return r;
+	}
+	static FixedVector2 from_float(double _x, double _y) { return from_raw(to_fixed(_x), to_fixed(_y)); }
+	static FixedVector2 from_pixel(Vector2 aPos) { return from_raw(to_fixed(aPos.x), to_fixed(aPos.y)); }
+};
+
 int		get_buffer_index(Vector2 pos, int WINDOW_WIDTH);
 Vector2 get_buffer_pixel(int index);
 Color	get_buffer_pixel_color(Vector2 pos, int WINDOW_WIDTH, unsigned char* screenbuffer);
 
 float lerp(float a, float b, float time, bool looping);
 Color lerpRGB(Color c1, Color c2, float time);
+
+// sRGB <-> linear-light tables. Linear values are 12-bit (0..LINEAR_MAX), enough
+// to round-trip every 8-bit sRGB value.
+const int LINEAR_BITS = 12;
+const int LINEAR_MAX  = (1 << LINEAR_BITS) - 1;
+
+extern uint16_t SRGB_TO_LINEAR[256];
+extern uint8_t	LINEAR_TO_SRGB[LINEAR_MAX + 1];
+
+// Out-of-range inputs (Color fields are plain ints) are clamped to the table.
+inline int srgb_to_linear(int c) { return SRGB_TO_LINEAR[std::min(std::max(c, 0), 255)]; }
+inline int linear_to_srgb(int l) { return LINEAR_TO_SRGB[std::min(std::max(l, 0), LINEAR_MAX)]; }
+
+// lerpRGB in linear light; alpha is interpolated as-is.
+Color lerpRGB_linear(Color c1, Color c2, float time);
+
+// How a drawn color combines with the pixel below. Every mode except Copy is
+// faded in by the source alpha.
+enum class BlendMode : uint8_t
+{
+	SrcOver,
+	Copy,
+	Add,
+	Multiply,
+	Screen,
+	Darken,
+	Lighten,
+	COUNT
+};
+
+// Straightforward per-pixel blend, used by blend_pixel and as the reference the
+// specialized span kernels must match exactly.
+Color blend_reference(BlendMode mode, Color src, Color dst, bool linear);
 float smoothstep(float t);
 bool  point_in_triangle(Vector2 aPoint, Vector2 t1, Vector2 t2, Vector2 t3);
 
+enum FillType : uint8_t
+{
+	FILL_UNKNOWN,
+	FILL_SOLID,
+	FILL_RADIAL_GRADIENT
+};
+
+struct Surface;
+
 class FillStyle
 {
 public:
 	virtual Color operator()(Vector2 aPos) const = 0;
 	virtual ~FillStyle()						 = default;
+
+	// Describes the fill for trace recording. Fills a replay cannot rebuild
+	// leave params empty and report FILL_UNKNOWN.
+	virtual FillType record(std::vector<int32_t>& params) const { return FILL_UNKNOWN; }
+
+	// True when every pixel gets the same color, which lets the rasterizer
+	// skip the per-pixel call.
+	virtual bool solid_color(Color& out) const { return false; }
+
+	// True when every pixel is fully opaque, so a draw with it hides what is
+	// behind it.
+	virtual bool opaque() const
+	{
+		Color color;
+		return solid_color(color) && color.a == 255;
+	}
+	// The surface behind an image fill and where it is placed, which lets the
+	// rasterizer read the pixels directly instead of calling operator().
+	virtual const Surface* image(Vector2& origin) const { return nullptr; }
 };
 
 class SolidFill : public FillStyle
@@ -59,6 +169,16 @@ public:
 	{
 	}
 	Color operator()(Vector2 aPos) const override { return color; }
+	bool  solid_color(Color& out) const override
+	{
+		out = color;
+		return true;
+	}
+	FillType record(std::vector<int32_t>& params) const override
+	{
+		params = { color.r, color.g, color.b, color.a };
+		return FILL_SOLID;
+	}
 };
 
 class RadialGradientFill : public FillStyle
@@ -66,13 +186,15 @@ class RadialGradientFill : public FillStyle
 	Vector2 center;
 	int		radius;
 	Color	centerRGB, edgeRGB;
+	bool	linear;
 
 public:
-	RadialGradientFill(Vector2 aPos, int r, Color centerColor, Color edgeColor)
+	RadialGradientFill(Vector2 aPos, int r, Color centerColor, Color edgeColor, bool linearLight = false)
 	: center(aPos)
 	, radius(r)
 	, centerRGB(centerColor)
 	, edgeRGB(edgeColor)
+	, linear(linearLight)
 	{
 	}
 	Color operator()(Vector2 aPos) const override
@@ -86,39 +208,284 @@ public:
 			return edgeRGB;
 
 		float t		  = distance / radius;
-		gradientColor = lerpRGB(centerRGB, edgeRGB, t);
+		gradientColor = linear ? lerpRGB_linear(centerRGB, edgeRGB, t) : lerpRGB(centerRGB, edgeRGB, t);
 		return gradientColor;
 	}
+	FillType record(std::vector<int32_t>& params) const override
+	{
+		params = { center.x,	center.y,	 radius,	  centerRGB.r, centerRGB.g, centerRGB.b,
+				   centerRGB.a, edgeRGB.r,	 edgeRGB.g,	  edgeRGB.b,   edgeRGB.a,	linear };
+		return FILL_RADIAL_GRADIENT;
+	}
+	bool opaque() const override { return centerRGB.a == 255 && edgeRGB.a == 255; }
 };
 
-class GWindow
+// Read-only view of BGRA pixels laid out like the screenbuffer (B at +0, R at +2).
+// Rows are stride bytes apart; the memory is owned elsewhere (e.g. an AssetPack).
+struct Surface
 {
+	const unsigned char* pixels;
+	int					 width, height, stride;
+	bool				 premultiplied;
+	Surface(const unsigned char* _pixels = nullptr, int _width = 0, int _height = 0, int _stride = 0, bool _premultiplied = false)
+	: pixels(_pixels)
+	, width(_width)
+	, height(_height)
+	, stride(_stride)
+	, premultiplied(_premultiplied){};
+};
+
+// Samples a surface placed with its top-left corner at origin. Pixels outside
+// the surface are fully transparent.
+class ImageFill : public FillStyle
+{
+	const Surface& surface;
+	Vector2		   origin;
+
 public:
-	void	set_screen(unsigned char* rgb_out, int w, int h);
-	XImage* create_ximage(Display* display, Visual* visual, int width, int height);
-	void	fill_rectangle(Vector2 aPos, int width, int height, const FillStyle& fillStyle);
-	void	fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle);
-	void	fill_circle(Vector2 center, int radius, const FillStyle& fillStyle);
-	void	fill_triangle(Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle);
+	ImageFill(const Surface& aSurface, Vector2 aOrigin)
+	: surface(aSurface)
+	, origin(aOrigin)
+	{
+	}
+	Color operator()(Vector2 aPos) const override
+	{
+		int x = aPos.x - origin.x, y = aPos.y - origin.y;
+		if (x < 0 || y < 0 || x >= surface.width || y >= surface.height)
+			return Color(0, 0, 0, 0);
+		const unsigned char* p = surface.pixels + y * surface.stride + x * 4;
+		int					 a = p[3];
+		if (surface.premultiplied && a != 0 && a != 255)
+			return Color((p[2] * 255 + a / 2) / a, (p[1] * 255 + a / 2) / a, (p[0] * 255 + a / 2) / a, a);
+		return Color(p[2], p[1], p[0], a);
+	}
+	const Surface* image(Vector2& aOrigin) const override
+	{
+		aOrigin = origin;
+		return &surface;
+	}
+};
+
+// Software rasterizer over a BGRA screenbuffer. Needs no display, so tools
+// such as the trace replayer can draw without X11.
+class Canvas
+{
+public:
+	void fill_rectangle(Vector2 aPos, int width, int height, const FillStyle& fillStyle);
+	void fill_line(Vector2 aPos1, Vector2 aPos2, const FillStyle& fillStyle);
+	void fill_circle(Vector2 center, int radius, const FillStyle& fillStyle);
+	void fill_triangle(Vector2 p1, Vector2 p2, Vector2 p3, const FillStyle& fillStyle);
+
+	// Sub-pixel variants: sizes and radii are 24.8 fixed-point, and a pixel is
+	// covered when its center lies inside the shape.
+	void fill_rectangle(FixedVector2 aPos, int width, int height, const FillStyle& fillStyle);
+	void fill_line(FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle);
+	void fill_circle(FixedVector2 center, int radius, const FillStyle& fillStyle);
+	void fill_triangle(FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle);
 
 	void fill_pixel(Vector2 aPos, Color aColor);
 	void blend_pixel(Vector2 aPos, Color aColor);
 
+	// Blend translucent pixels in linear light instead of on sRGB bytes.
+	void set_linear_blending(bool enabled) { m_LinearBlending = enabled; }
+
+	// Blend mode for the following draws; out-of-range modes fall back to SrcOver.
+	void set_blend_mode(BlendMode mode)
+	{
+		m_BlendMode = mode < BlendMode::COUNT ? mode : BlendMode::SrcOver;
+	}
+	BlendMode blend_mode() const { return m_BlendMode; }
+
+	// Routes every span through blend_pixel/blend_reference instead of the
+	// specialized kernels, for checking the kernels against it.
+	void set_reference_blending(bool enabled) { m_ReferenceBlending = enabled; }
+
+	// Records every fill_* shape call into aTrace (nullptr stops recording).
+	void set_trace(TraceRecorder* aTrace) { m_Trace = aTrace; }
+
+	// Depth for the following fill_* shape calls; 0 turns the test off. A
+	// pixel is only drawn when the depth is greater than the one stored for it,
+	// and draws that occlude() store theirs, so opaque draws issued front to
+	// back skip covered pixels before the FillStyle runs. The buffer is
+	// allocated on first use and reset by clear().
+	void	 set_depth(uint32_t depth);
+	uint32_t depth() const { return m_Depth; }
+	// Hands out count consecutive depths above every depth reserved since the
+	// last clear(), so separate batches keep their order within a frame.
+	uint32_t reserve_depth(uint32_t count);
+	// Whether a draw with fillStyle in mode hides what is behind it.
+	static bool occludes(const FillStyle& fillStyle, BlendMode mode)
+	{
+		return mode == BlendMode::Copy || (mode == BlendMode::SrcOver && fillStyle.opaque());
+	}
+
+	bool linear_blending() const { return m_LinearBlending; }
+
+	// Buffer size in pixels. Drawing coordinates are logical pixels, which
+	// differ from buffer pixels when a scale is set.
+	int					 width() const { return WINDOW_WIDTH; }
+	int					 height() const { return WINDOW_HEIGHT; }
+	int					 logical_width() const { return (int) ((int64_t) WINDOW_WIDTH * FIXED_ONE / m_Scale); }
+	int					 logical_height() const { return (int) ((int64_t) WINDOW_HEIGHT * FIXED_ONE / m_Scale); }
+	const unsigned char* pixels() const { return screenbuffer; }
+	void				 clear()
+	{
+		memset(screenbuffer, 255, WINDOW_PIXEL);
+		clear_depth();
+	}
+
+	// Reallocates the buffer (from the surface pool) and clears it.
+	void resize(int width, int height);
+
+	// Buffer pixels per logical pixel in 24.8 fixed-point. At anything but
+	// FIXED_ONE the Vector2 overloads take the sub-pixel path and FillStyles
+	// are sampled in logical coordinates. fill_pixel/blend_pixel always
+	// address buffer pixels.
+	void set_scale(int scale);
+	int	 scale() const { return m_Scale; }
+
+	// Scratch memory for the current frame, reset after every present.
+	FrameArena& frame_arena() { return m_Arena; }
+
+	Canvas(int width, int height, bool hugePages = false);
+	~Canvas();
+
+protected:
+	typedef void (*SpanFn)(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid);
+
+	// Writes horizontal runs of one draw call. The kernel is chosen once per
+	// draw from the blend mode, blending space and fill type. With a depth set
+	// the run is split into the pixels that pass the depth test.
+	struct SpanWriter
+	{
+		Canvas&			 canvas;
+		SpanFn			 kernel;
+		const FillStyle& fillStyle;
+		Color			 solid;
+		uint32_t*		 depthBuffer;
+		uint32_t		 depth;
+		bool			 writeDepth;
+
+		void operator()(int y, int x0, int x1) const
+		{
+			if (y < 0 || y >= canvas.WINDOW_HEIGHT)
+				return;
+			x0 = std::max(x0, 0);
+			x1 = std::min(x1, canvas.WINDOW_WIDTH);
+			if (x0 >= x1)
+				return;
+			if (depthBuffer == nullptr)
+				return kernel(canvas, y, x0, x1, fillStyle, solid);
+
+			uint32_t* row = depthBuffer + (size_t) y * canvas.WINDOW_WIDTH;
+			while (x0 < x1)
+			{
+				while (x0 < x1 && row[x0] >= depth)
+					++x0;
+				int start = x0;
+				while (x0 < x1 && row[x0] < depth)
+				{
+					if (writeDepth)
+						row[x0] = depth;
+					++x0;
+				}
+				if (start < x0)
+					kernel(canvas, y, start, x0, fillStyle, solid);
+			}
+		}
+	};
+
+	SpanWriter span_writer(const FillStyle& fillStyle);
+
+	template <BlendMode M, bool Linear, bool Solid>
+	static void span_kernel(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid);
+	// Src-over of an unscaled image fill, reading premultiplied surfaces as
+	// they are stored.
+	template <bool Premultiplied>
+	static void span_image(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid);
+	static void span_reference(Canvas& canvas, int y, int x0, int x1, const FillStyle& fillStyle, Color solid);
+
+	uint8_t trace_state() const;
+	void	clear_depth();
+	size_t	depth_bytes() const { return (size_t) WINDOW_WIDTH * WINDOW_HEIGHT * sizeof(uint32_t); }
+
+	// The sub-pixel rasterizers, in buffer coordinates.
+	void raster_rectangle(FixedVector2 aPos, int width, int height, const FillStyle& fillStyle);
+	void raster_line(FixedVector2 aPos1, FixedVector2 aPos2, const FillStyle& fillStyle);
+	void raster_circle(FixedVector2 center, int radius, const FillStyle& fillStyle);
+	void raster_triangle(FixedVector2 p1, FixedVector2 p2, FixedVector2 p3, const FillStyle& fillStyle);
+
+	int			 to_buffer(int length) const { return (int) ((int64_t) length * m_Scale >> FIXED_SHIFT); }
+	FixedVector2 to_buffer(FixedVector2 p) const { return FixedVector2::from_raw(to_buffer(p.x), to_buffer(p.y)); }
+	Vector2		 logical(int x, int y) const
+	{
+		if (m_Scale == FIXED_ONE)
+			return Vector2(x, y);
+		return Vector2(fixed_floor((int) (((int64_t) (x * FIXED_ONE + FIXED_HALF) * m_InvScale) >> 16)),
+					   fixed_floor((int) (((int64_t) (y * FIXED_ONE + FIXED_HALF) * m_InvScale) >> 16)));
+	}
+
+	int			   WINDOW_WIDTH;
+	int			   WINDOW_HEIGHT;
+	int			   WINDOW_PIXEL;
+	const int	   BYTES_PER_PIXEL = 4;
+	unsigned char* screenbuffer;
+	TraceRecorder* m_Trace			= nullptr;
+	bool		   m_LinearBlending	   = false;
+	BlendMode	   m_BlendMode		   = BlendMode::SrcOver;
+	bool		   m_ReferenceBlending = false;
+	uint32_t*	   m_DepthBuffer	   = nullptr;
+	uint32_t	   m_Depth			   = 0;
+	uint32_t	   m_DepthReserved	   = 0;
+	int			   m_Scale			= FIXED_ONE;
+	int64_t		   m_InvScale		= (int64_t) 1 << 16;
+	bool		   m_HugePages;
+	SurfacePool	   m_Pool;
+	FrameArena	   m_Arena;
+};
+
+class GWindow : public Canvas
+{
+public:
+	void	set_screen(unsigned char* rgb_out, int w, int h);
+	XImage* create_ximage(Display* display, Visual* visual, int width, int height);
+
+	// Hands every presented frame to aCapture (nullptr stops capturing).
+	void set_capture(FrameCapture* aCapture) { m_Capture = aCapture; }
+
+	// Renders at scale times the window size and stretches the result when
+	// presenting. Drawing coordinates stay in window pixels. Turns off
+	// automatic scaling.
+	void set_render_scale(float scale);
+	// Lowers the render scale (down to minScale) while frames, from clear()
+	// through presenting, take longer than targetSeconds, and raises it back
+	// towards 1 when there is headroom.
+	void set_auto_scale(double targetSeconds, float minScale = 0.5f);
+	void set_upscale_filter(Upscale filter) { m_Upscale = filter; }
+	float render_scale() const { return m_RenderScale; }
+
+	// Heap allocations made by the last frame, from clear() through presenting
+	// and capture. Steady-state frames should report 0. Always 0 unless built
+	// with GPH_COUNT_ALLOCATIONS (see heap_allocation_count()).
+	uint64_t frame_allocations() const { return m_FrameAllocations; }
+
 	void Update();
 	void Tick();
 	void Start();
 	void Close();
 
-	GWindow(int width = 640, int height = 480, std::string title = "Window");
+	// hugePages backs the screenbuffer and output image with huge pages.
+	GWindow(int width = 640, int height = 480, std::string title = "Window", bool hugePages = false);
 	~GWindow();
 
 protected:
-	int											   WINDOW_WIDTH;
-	int											   WINDOW_HEIGHT;
-	int											   WINDOW_PIXEL;
-	const int									   BYTES_PER_PIXEL = 4;
+	void destroy_ximage();
+	void resize_window(int width, int height);
+	void apply_render_scale();
+	void present();
+	void adjust_auto_scale(double frameSeconds);
+
 	std::string									   WINDOW_TITLE;
-	unsigned char*								   screenbuffer;
 	std::chrono::high_resolution_clock::time_point program_start_clock;
 	std::chrono::duration<double>				   elapsed_time;
 	float										   double_timestep;
@@ -128,6 +495,17 @@ protected:
 	Window										   m_Window;
 	GC											   m_Graphics;
 	XEvent										   m_Event;
+	FrameCapture*								   m_Capture = nullptr;
+	int											   m_OutputWidth;
+	int											   m_OutputHeight;
+	float										   m_RenderScale = 1;
+	Upscale										   m_Upscale	 = Upscale::Bilinear;
+	bool										   m_AutoScale	 = false;
+	double										   m_TargetFrameTime;
+	float										   m_MinScale;
+	double										   m_AverageFrameTime = 0;
+	int											   m_FramesSinceScale = 0;
+	uint64_t									   m_FrameAllocations = 0;
 };
 
 
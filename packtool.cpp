@@ -0,0 +1,204 @@
+// Bakes images into an asset pack of pre-converted BGRA for AssetPack.
+// Usage: ./packtool out.gpak [--premultiply] image.ppm image.pam ...
+// Accepts binary PPM (P6) and PAM (P7, RGB or RGB_ALPHA) with 8-bit channels;
+// convert PNGs first, e.g. `convert card.png card.pam`.
+#include "assetpack.hpp"
+#include <cctype>
+#include <cstdio>
+
+using namespace gph;
+
+struct Image
+{
+	std::string				   name;
+	int						   width = 0, height = 0;
+	std::vector<unsigned char> rgba;
+};
+
+static bool read_token(FILE* file, std::string& token)
+{
+	token.clear();
+	int c = fgetc(file);
+	while (c != EOF)
+	{
+		if (c == '#')
+		{
+			while (c != EOF && c != '\n')
+				c = fgetc(file);
+		}
+		else if (!isspace(c))
+			break;
+		c = fgetc(file);
+	}
+	while (c != EOF && !isspace(c))
+	{
+		token += (char) c;
+		c = fgetc(file);
+	}
+	return !token.empty();
+}
+
+static bool load_image(const char* path, Image& image)
+{
+	FILE* file = fopen(path, "rb");
+	if (file == nullptr)
+	{
+		std::cout << "Cannot open " << path << std::endl;
+		return false;
+	}
+
+	std::string token, magic;
+	int			depth = 3, maxval = 0;
+	read_token(file, magic);
+	if (magic == "P6")
+	{
+		read_token(file, token);
+		image.width = atoi(token.c_str());
+		read_token(file, token);
+		image.height = atoi(token.c_str());
+		read_token(file, token);
+		maxval = atoi(token.c_str());
+	}
+	else if (magic == "P7")
+	{
+		while (read_token(file, token) && token != "ENDHDR")
+		{
+			std::string value;
+			read_token(file, value);
+			if (token == "WIDTH")
+				image.width = atoi(value.c_str());
+			else if (token == "HEIGHT")
+				image.height = atoi(value.c_str());
+			else if (token == "DEPTH")
+				depth = atoi(value.c_str());
+			else if (token == "MAXVAL")
+				maxval = atoi(value.c_str());
+		}
+	}
+	if ((magic != "P6" && magic != "P7") || maxval != 255 || (depth != 3 && depth != 4) || image.width <= 0
+		|| image.height <= 0)
+	{
+		std::cout << "Unsupported image (need 8-bit P6 or P7): " << path << std::endl;
+		fclose(file);
+		return false;
+	}
+
+	size_t					   pixels = (size_t) image.width * image.height;
+	std::vector<unsigned char> raw(pixels * depth);
+	bool					   ok = fread(raw.data(), 1, raw.size(), file) == raw.size();
+	fclose(file);
+	if (!ok)
+	{
+		std::cout << "Truncated image: " << path << std::endl;
+		return false;
+	}
+
+	image.rgba.resize(pixels * 4);
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		image.rgba[i * 4 + 0] = raw[i * depth + 0];
+		image.rgba[i * 4 + 1] = raw[i * depth + 1];
+		image.rgba[i * 4 + 2] = raw[i * depth + 2];
+		image.rgba[i * 4 + 3] = depth == 4 ? raw[i * depth + 3] : 255;
+	}
+
+	std::string base = path;
+	size_t		slash = base.find_last_of('/');
+	if (slash != std::string::npos)
+		base = base.substr(slash + 1);
+	size_t dot = base.find_last_of('.');
+	image.name = base.substr(0, dot);
+	if (image.name.size() >= PACK_NAME_BYTES)
+	{
+		std::cout << "Image name too long: " << image.name << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static uint64_t align_up(uint64_t v) { return (v + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN; }
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: " << argv[0] << " out.gpak [--premultiply] images..." << std::endl;
+		return 1;
+	}
+
+	bool			   premultiply = false;
+	std::vector<Image> images;
+	for (int i = 2; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--premultiply") == 0)
+		{
+			premultiply = true;
+			continue;
+		}
+		Image image;
+		if (!load_image(argv[i], image))
+			return 1;
+		images.push_back(std::move(image));
+	}
+
+	PackHeader header;
+	memcpy(header.magic, PACK_MAGIC, 4);
+	header.version	= PACK_VERSION;
+	header.count	= images.size();
+	header.reserved = 0;
+
+	std::vector<PackEntry> entries(images.size());
+	uint64_t			   offset = align_up(sizeof(PackHeader) + entries.size() * sizeof(PackEntry));
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		PackEntry& entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		strncpy(entry.name, images[i].name.c_str(), PACK_NAME_BYTES - 1);
+		entry.width	 = images[i].width;
+		entry.height = images[i].height;
+		entry.stride = align_up(entry.width * 4);
+		entry.flags	 = premultiply ? PACK_PREMULTIPLIED : 0;
+		entry.offset = offset;
+		entry.size	 = (uint64_t) entry.stride * entry.height;
+		offset		 = align_up(offset + entry.size);
+	}
+
+	FILE* out = fopen(argv[1], "wb");
+	if (out == nullptr)
+	{
+		std::cout << "Cannot write " << argv[1] << std::endl;
+		return 1;
+	}
+	std::vector<unsigned char> data(offset, 0);
+	memcpy(data.data(), &header, sizeof(header));
+	memcpy(data.data() + sizeof(header), entries.data(), entries.size() * sizeof(PackEntry));
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		const Image& image = images[i];
+		for (int y = 0; y < image.height; ++y)
+		{
+			unsigned char*		 dst = data.data() + entries[i].offset + (uint64_t) y * entries[i].stride;
+			const unsigned char* src = image.rgba.data() + (size_t) y * image.width * 4;
+			for (int x = 0; x < image.width; ++x, dst += 4, src += 4)
+			{
+				int a  = src[3];
+				int r  = premultiply ? (src[0] * a + 127) / 255 : src[0];
+				int g  = premultiply ? (src[1] * a + 127) / 255 : src[1];
+				int b  = premultiply ? (src[2] * a + 127) / 255 : src[2];
+				dst[0] = b;	 // B
+				dst[1] = g;	 // G
+				dst[2] = r;	 // R
+				dst[3] = a;	 // A
+			}
+		}
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), out) == data.size();
+	fclose(out);
+	if (!ok)
+	{
+		std::cout << "Short write to " << argv[1] << std::endl;
+		return 1;
+	}
+	std::cout << "Packed " << images.size() << " images (" << data.size() << " bytes)" << std::endl;
+	return 0;
+}
@@ -0,0 +1,251 @@
+// Replays a draw-call trace headlessly and reports where the time went.
+// Usage: ./replay trace.gtrc [-o out.ppm] [--frame N] [-v] [--reference | --check]
+//        ./replay --sweep
+// -v prints every call; otherwise calls are summarized per primitive.
+// --reference draws through the scalar blend_reference path instead of the
+// span kernels; --check draws both and reports pixels where they differ.
+// --sweep needs no trace: it draws every blend mode, blending space, scale
+// and fill kind over a noisy background with the kernels and the reference
+// and reports any difference. Premultiplied images may differ by 1 per
+// channel, since the reference has to un-premultiply them first.
+#include "trace.hpp"
+
+using namespace gph;
+
+struct OpStats
+{
+	uint64_t calls = 0;
+	double	 total = 0.0;
+	double	 worst = 0.0;
+};
+
+static bool write_ppm(const char* path, const Canvas& canvas)
+{
+	FILE* out = fopen(path, "wb");
+	if (out == nullptr)
+		return false;
+	fprintf(out, "P6\n%d %d\n255\n", canvas.width(), canvas.height());
+	const unsigned char* src = canvas.pixels();
+	for (int i = 0; i < canvas.width() * canvas.height(); ++i, src += 4)
+	{
+		unsigned char rgb[3] = { src[2], src[1], src[0] };
+		fwrite(rgb, 1, 3, out);
+	}
+	return fclose(out) == 0;
+}
+
+static int sweep_kernels()
+{
+	const int W = 64, H = 48;
+	srand(1);
+	std::vector<unsigned char> straight(W * H * 4), premultiplied(W * H * 4), background(W * H * 4);
+	for (int i = 0; i < W * H; ++i)
+	{
+		int a = rand() % 4 == 0 ? 255 : (rand() % 4 == 0 ? 0 : rand() % 256);
+		for (int c = 0; c < 3; ++c)
+		{
+			straight[i * 4 + c]		 = rand() % 256;
+			premultiplied[i * 4 + c] = (straight[i * 4 + c] * a + 127) / 255;
+		}
+		straight[i * 4 + 3] = premultiplied[i * 4 + 3] = a;
+	}
+	for (unsigned char& byte : background)
+		byte = rand() % 256;
+
+	Surface			   straightSurface(straight.data(), W, H, W * 4, false);
+	Surface			   premultipliedSurface(premultiplied.data(), W, H, W * 4, true);
+	SolidFill		   opaque(Color(200, 40, 90, 255)), translucent(Color(20, 180, 250, 100)), clear(Color(9, 9, 9, 0));
+	SolidFill		   outOfRange(Color(300, -1, 20, 255)), outOfRangeAlpha(Color(-40, 260, 128, 400));
+	RadialGradientFill gradient(Vector2(30, 20), 25, Color(255, 200, 0, 255), Color(0, 60, 255, 40));
+	ImageFill		   straightImage(straightSurface, Vector2(3, 2)), premultipliedImage(premultipliedSurface, Vector2(3, 2));
+	const struct
+	{
+		const char*		 name;
+		const FillStyle& fill;
+		int				 tolerance;
+	} fills[] = { { "opaque solid", opaque, 0 },		  { "translucent solid", translucent, 0 },
+				  { "transparent solid", clear, 0 },	  { "gradient", gradient, 0 },
+				  { "straight image", straightImage, 0 }, { "premultiplied image", premultipliedImage, 1 },
+				  { "out-of-range solid", outOfRange, 0 },  { "out-of-range alpha", outOfRangeAlpha, 0 } };
+	const int scales[] = { FIXED_ONE, FIXED_ONE * 3 / 4 };
+
+	Canvas kernels(W, H), reference(W, H);
+	reference.set_reference_blending(true);
+	int failures = 0;
+	for (int mode = 0; mode < (int) BlendMode::COUNT; ++mode)
+		for (int linear = 0; linear < 2; ++linear)
+			for (int scale : scales)
+				for (const auto& fill : fills)
+				{
+					for (Canvas* canvas : { &kernels, &reference })
+					{
+						for (int i = 0; i < W * H; ++i)
+						{
+							const unsigned char* p = background.data() + i * 4;
+							canvas->fill_pixel(Vector2(i % W, i / W), Color(p[2], p[1], p[0], p[3]));
+						}
+						canvas->set_scale(scale);
+						canvas->set_blend_mode((BlendMode) mode);
+						canvas->set_linear_blending(linear);
+						canvas->fill_rectangle(Vector2(-4, 1), W - 6, H / 2, fill.fill);
+						canvas->fill_circle(Vector2(W / 2, H * 2 / 3), H / 3, fill.fill);
+					}
+
+					int differ = 0;
+					for (int i = 0; i < W * H * 4; ++i)
+					{
+						if (abs(kernels.pixels()[i] - reference.pixels()[i]) > fill.tolerance)
+							++differ;
+					}
+					if (differ)
+					{
+						printf("mode %d %s scale %d %s: %d bytes differ\n",
+							   mode,
+							   linear ? "linear" : "sRGB",
+							   scale,
+							   fill.name,
+							   differ);
+						++failures;
+					}
+				}
+	std::cout << (failures ? "Kernels differ from the reference" : "Kernels match the reference") << std::endl;
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* tracePath = nullptr;
+	const char* imagePath = "replay.ppm";
+	int			onlyFrame = -1;
+	bool		verbose	  = false;
+	bool		reference = false;
+	bool		check	  = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			imagePath = argv[++i];
+		else if (strcmp(argv[i], "--frame") == 0 && i + 1 < argc)
+			onlyFrame = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-v") == 0)
+			verbose = true;
+		else if (strcmp(argv[i], "--reference") == 0)
+			reference = true;
+		else if (strcmp(argv[i], "--check") == 0)
+			check = true;
+		else if (strcmp(argv[i], "--sweep") == 0)
+			return sweep_kernels();
+		else
+			tracePath = argv[i];
+	}
+	if (tracePath == nullptr)
+	{
+		std::cout << "Usage: " << argv[0] << " trace.gtrc [-o out.ppm] [--frame N] [-v] [--reference | --check]"
+				  << std::endl
+				  << "       " << argv[0] << " --sweep" << std::endl;
+		return 1;
+	}
+
+	TraceReader reader;
+	if (!reader.open(tracePath))
+		return 1;
+
+	Canvas*	   canvas	 = nullptr;
+	Canvas*	   expected	 = nullptr;
+	int		   mismatches = 0;
+	TraceFrame frame;
+	OpStats	   stats[TRACE_OP_COUNT];
+	int		   unknownFills = 0;
+	for (int index = 0; reader.next_frame(frame); ++index)
+	{
+		if (onlyFrame >= 0 && index != onlyFrame)
+			continue;
+		if (canvas == nullptr)
+			canvas = new Canvas(frame.width, frame.height);
+		canvas->resize(frame.width, frame.height);
+		canvas->set_scale(frame.scale);
+		canvas->set_reference_blending(reference);
+		canvas->clear();
+
+		double frameTime = 0.0;
+		for (size_t i = 0; i < frame.calls.size(); ++i)
+		{
+			const TraceCall& call = frame.calls[i];
+			if (call.fill == FILL_UNKNOWN)
+				++unknownFills;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			call.execute(*canvas);
+			std::chrono::duration<double, std::micro> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+			OpStats& op = stats[call.op];
+			op.calls++;
+			op.total += elapsed.count();
+			op.worst = std::max(op.worst, elapsed.count());
+			frameTime += elapsed.count();
+			if (verbose)
+				printf("frame %d call %zu %-22s fill %d %10.2f us\n",
+					   index,
+					   i,
+					   trace_op_name(call.op),
+					   call.fill,
+					   elapsed.count());
+		}
+		printf("frame %d: %zu calls, %.2f us\n", index, frame.calls.size(), frameTime);
+
+		if (check)
+		{
+			if (expected == nullptr)
+				expected = new Canvas(frame.width, frame.height);
+			expected->resize(frame.width, frame.height);
+			expected->set_scale(frame.scale);
+			expected->set_reference_blending(true);
+			expected->clear();
+			for (const TraceCall& call : frame.calls)
+				call.execute(*expected);
+
+			int differ = 0;
+			for (int i = 0; i < frame.width * frame.height; ++i)
+			{
+				if (memcmp(canvas->pixels() + i * 4, expected->pixels() + i * 4, 4) != 0)
+					++differ;
+			}
+			if (differ)
+				printf("frame %d: %d pixels differ from the reference\n", index, differ);
+			mismatches += differ;
+		}
+	}
+	delete expected;
+
+	if (canvas == nullptr)
+	{
+		std::cout << "No frames replayed" << std::endl;
+		return 1;
+	}
+
+	printf("\n%-22s %10s %12s %12s %12s\n", "primitive", "calls", "total us", "avg us", "worst us");
+	for (int op = 0; op < TRACE_OP_COUNT; ++op)
+	{
+		if (stats[op].calls == 0)
+			continue;
+		printf("%-22s %10lu %12.2f %12.2f %12.2f\n",
+			   trace_op_name((TraceOp) op),
+			   (unsigned long) stats[op].calls,
+			   stats[op].total,
+			   stats[op].total / stats[op].calls,
+			   stats[op].worst);
+	}
+	if (unknownFills)
+		printf("%d calls used fills the trace cannot rebuild (drawn magenta)\n", unknownFills);
+
+	bool ok = write_ppm(imagePath, *canvas);
+	delete canvas;
+	if (!ok)
+	{
+		std::cout << "Cannot write " << imagePath << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << imagePath << std::endl;
+	if (check)
+		std::cout << (mismatches ? "Kernels differ from the reference" : "Kernels match the reference") << std::endl;
+	return mismatches ? 1 : 0;
+}
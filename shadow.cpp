@@ -0,0 +1,171 @@
+#include "shadow.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gph
+{
+
+// Adds (or subtracts) a row of coverage to the per-column window sums.
+template <bool Subtract> static void accumulate(uint32_t* sums, const uint8_t* in, int width)
+{
+	int x = 0;
+#ifdef __SSE2__
+	__m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i bytes	 = _mm_loadu_si128((const __m128i*) (in + x));
+		__m128i lo		 = _mm_unpacklo_epi8(bytes, zero);
+		__m128i hi		 = _mm_unpackhi_epi8(bytes, zero);
+		__m128i parts[4] = { _mm_unpacklo_epi16(lo, zero),
+							 _mm_unpackhi_epi16(lo, zero),
+							 _mm_unpacklo_epi16(hi, zero),
+							 _mm_unpackhi_epi16(hi, zero) };
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128i* sum = (__m128i*) (sums + x + 4 * i);
+			__m128i	 v	 = _mm_loadu_si128(sum);
+			_mm_storeu_si128(sum, Subtract ? _mm_sub_epi32(v, parts[i]) : _mm_add_epi32(v, parts[i]));
+		}
+	}
+#endif
+	for (; x < width; ++x)
+		sums[x] = Subtract ? sums[x] - in[x] : sums[x] + in[x];
+}
+
+// Writes the window averages; scale is the reciprocal of the window size.
+static void average(const uint32_t* sums, uint8_t* out, int width, float scale)
+{
+	int x = 0;
+#ifdef __SSE2__
+	__m128 factor = _mm_set1_ps(scale);
+	__m128 half	  = _mm_set1_ps(0.5f);
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i v[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128 sum = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (sums + x + 4 * i)));
+			v[i]	   = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, factor), half));
+		}
+		_mm_storeu_si128((__m128i*) (out + x), _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
+	}
+#endif
+	for (; x < width; ++x)
+		out[x] = (uint8_t) ((float) sums[x] * scale + 0.5f);
+}
+
+// Slides the window down all columns at once, sixteen columns per SSE2 step.
+static void blur_columns(const uint8_t* src, uint8_t* dst, int width, int height, int radius, uint32_t* sums)
+{
+	float scale = 1.0f / (2 * radius + 1);
+	memset(sums, 0, width * sizeof(uint32_t));
+	for (int y = 0; y < std::min(radius, height); ++y)
+		accumulate<false>(sums, src + (size_t) y * width, width);
+	for (int y = 0; y < height; ++y)
+	{
+		if (y + radius < height)
+			accumulate<false>(sums, src + (size_t) (y + radius) * width, width);
+		average(sums, dst + (size_t) y * width, width, scale);
+		if (y - radius >= 0)
+			accumulate<true>(sums, src + (size_t) (y - radius) * width, width);
+	}
+}
+
+// Blocked so both sides stay within a few cache lines per tile.
+static void transpose(const uint8_t* src, uint8_t* dst, int width, int height)
+{
+	const int TILE = 16;
+	for (int y0 = 0; y0 < height; y0 += TILE)
+		for (int x0 = 0; x0 < width; x0 += TILE)
+			for (int y = y0; y < std::min(y0 + TILE, height); ++y)
+				for (int x = x0; x < std::min(x0 + TILE, width); ++x)
+					dst[(size_t) x * height + y] = src[(size_t) y * width + x];
+}
+
+int box_blur_reach(int radius) { return 3 * std::max(radius / 3, 1); }
+
+void box_blur(uint8_t* mask, int width, int height, int radius)
+{
+	int box = std::max(radius / 3, 1);
+	if (radius <= 0 || width <= 0 || height <= 0)
+		return;
+
+	// Both directions run as column passes, the horizontal ones on a
+	// transposed copy, so every pass uses the vectorized row loops.
+	std::vector<uint8_t>  a((size_t) width * height), b((size_t) width * height);
+	std::vector<uint32_t> sums(std::max(width, height));
+	blur_columns(mask, a.data(), width, height, box, sums.data());
+	blur_columns(a.data(), b.data(), width, height, box, sums.data());
+	blur_columns(b.data(), a.data(), width, height, box, sums.data());
+	transpose(a.data(), b.data(), width, height);
+	blur_columns(b.data(), a.data(), height, width, box, sums.data());
+	blur_columns(a.data(), b.data(), height, width, box, sums.data());
+	blur_columns(b.data(), a.data(), height, width, box, sums.data());
+	transpose(a.data(), mask, height, width);
+}
+
+static void fill_coverage(ShadowMask& mask, ShadowShape shape, int width, int height, int cornerRadius)
+{
+	int pad = mask.offset;
+	if (shape == ShadowShape::Circle)
+		cornerRadius = std::min(width, height) / 2;
+	else if (shape == ShadowShape::Rectangle)
+		cornerRadius = 0;
+	cornerRadius = std::min(cornerRadius, std::min(width, height) / 2);
+
+	for (int y = 0; y < height; ++y)
+	{
+		uint8_t* row = mask.alpha.data() + (size_t) (y + pad) * mask.width + pad;
+		for (int x = 0; x < width; ++x)
+		{
+			// Distance test against the nearest corner center, only inside the
+			// corner squares; everything else is fully covered.
+			int cx = x < cornerRadius ? cornerRadius : (x >= width - cornerRadius ? width - cornerRadius : x);
+			int cy = y < cornerRadius ? cornerRadius : (y >= height - cornerRadius ? height - cornerRadius : y);
+			int dx = 2 * (x - cx) + 1, dy = 2 * (y - cy) + 1;
+			if (cx == x || cy == y || dx * dx + dy * dy <= 4 * cornerRadius * cornerRadius)
+				row[x] = 255;
+		}
+	}
+}
+
+const ShadowMask& ShadowCache::get(ShadowShape shape, int width, int height, int blurRadius, int cornerRadius)
+{
+	if (shape != ShadowShape::RoundedRectangle)
+		cornerRadius = 0;
+	width		 = std::min(std::max(width, 0), 0xffff);
+	height		 = std::min(std::max(height, 0), 0xffff);
+	blurRadius	 = std::min(std::max(blurRadius, 0), 0xfff);
+	cornerRadius = std::min(std::max(cornerRadius, 0), 0xfff);
+	uint64_t key = (uint64_t) shape << 56 | (uint64_t) width << 40 | (uint64_t) height << 24
+				   | (uint64_t) blurRadius << 12 | (uint64_t) cornerRadius;
+
+	auto found = masks.find(key);
+	if (found != masks.end())
+	{
+		++m_Hits;
+		return found->second;
+	}
+	++m_Misses;
+
+	ShadowMask& mask = masks[key];
+	// One ring past the blur's reach stays empty, so the composited rectangle
+	// ends on fully transparent pixels.
+	mask.offset		 = blurRadius ? box_blur_reach(blurRadius) + 1 : 0;
+	mask.width		 = width + 2 * mask.offset;
+	mask.height		 = height + 2 * mask.offset;
+	mask.alpha.assign((size_t) mask.width * mask.height, 0);
+	fill_coverage(mask, shape, width, height, cornerRadius);
+	box_blur(mask.alpha.data(), mask.width, mask.height, blurRadius);
+	return mask;
+}
+
+void draw_shadow(Canvas& canvas, Vector2 aPos, const ShadowMask& mask, Color color)
+{
+	Vector2 origin(aPos.x - mask.offset, aPos.y - mask.offset);
+	canvas.fill_rectangle(origin, mask.width, mask.height, MaskFill(mask, origin, color));
+}
+
+};
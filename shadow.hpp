@@ -0,0 +1,75 @@
+#pragma once
+
+#include "graphics.hpp"
+#include <unordered_map>
+
+namespace gph
+{
+
+enum class ShadowShape : uint8_t
+{
+	Rectangle,
+	RoundedRectangle,
+	Circle
+};
+
+// Blurred coverage of a shape. The mask is padded by the blur's reach on every
+// side, so it is drawn offset pixels up and left of the shape's position.
+struct ShadowMask
+{
+	int					 width, height, offset;
+	std::vector<uint8_t> alpha;
+};
+
+// Blurs an 8-bit mask in place with three passes of a sliding-window box blur
+// in each direction, which approximates a Gaussian whose extent is about
+// radius pixels. Cost per pixel does not depend on the radius.
+void box_blur(uint8_t* mask, int width, int height, int radius);
+// How far box_blur spreads coverage: three passes of max(radius / 3, 1).
+int box_blur_reach(int radius);
+
+// Builds shadow masks on first use and hands back the same mask for every
+// later request with the same shape, size and radii.
+class ShadowCache
+{
+public:
+	const ShadowMask& get(ShadowShape shape, int width, int height, int blurRadius, int cornerRadius = 0);
+
+	size_t	 size() const { return masks.size(); }
+	uint64_t hits() const { return m_Hits; }
+	uint64_t misses() const { return m_Misses; }
+	void	 clear() { masks.clear(); }
+
+protected:
+	std::unordered_map<uint64_t, ShadowMask> masks;
+	uint64_t								 m_Hits	  = 0;
+	uint64_t								 m_Misses = 0;
+};
+
+// Tints a mask with color; the mask scales the color's alpha.
+class MaskFill : public FillStyle
+{
+	const ShadowMask& mask;
+	Vector2			  origin;
+	Color			  color;
+
+public:
+	MaskFill(const ShadowMask& aMask, Vector2 aOrigin, Color aColor)
+	: mask(aMask)
+	, origin(aOrigin)
+	, color(aColor)
+	{
+	}
+	Color operator()(Vector2 aPos) const override
+	{
+		int x = aPos.x - origin.x, y = aPos.y - origin.y;
+		if (x < 0 || y < 0 || x >= mask.width || y >= mask.height)
+			return Color(color.r, color.g, color.b, 0);
+		return Color(color.r, color.g, color.b, (color.a * mask.alpha[y * mask.width + x] + 127) / 255);
+	}
+};
+
+// Composites a shadow for a shape whose top-left corner is at aPos in one pass.
+void draw_shadow(Canvas& canvas, Vector2 aPos, const ShadowMask& mask, Color color);
+
+};
@@ -0,0 +1,276 @@
+#include "trace.hpp"
+
+namespace gph
+{
+
+int trace_op_args(TraceOp op)
+{
+	switch (op)
+	{
+	case TRACE_RECTANGLE:
+	case TRACE_RECTANGLE_FIXED:
+	case TRACE_LINE:
+	case TRACE_LINE_FIXED: return 4;
+	case TRACE_CIRCLE:
+	case TRACE_CIRCLE_FIXED: return 3;
+	case TRACE_TRIANGLE:
+	case TRACE_TRIANGLE_FIXED: return 6;
+	default: return -1;
+	}
+}
+
+const char* trace_op_name(TraceOp op)
+{
+	static const char* names[TRACE_OP_COUNT] = { "fill_rectangle",		  "fill_line",
+												 "fill_circle",			  "fill_triangle",
+												 "fill_rectangle(fixed)", "fill_line(fixed)",
+												 "fill_circle(fixed)",	  "fill_triangle(fixed)" };
+	return op < TRACE_OP_COUNT ? names[op] : "unknown";
+}
+
+static void put_varint(std::vector<uint8_t>& out, int32_t value)
+{
+	uint32_t v = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+	while (v >= 0x80)
+	{
+		out.push_back((uint8_t) (v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((uint8_t) v);
+}
+
+static bool get_varint(const uint8_t*& p, const uint8_t* end, int32_t& value)
+{
+	uint32_t v = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (p == end)
+			return false;
+		uint8_t byte = *p++;
+		v |= (uint32_t) (byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			value = (int32_t) (v >> 1) ^ -(int32_t) (v & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool read_varint(FILE* file, int32_t& value)
+{
+	uint8_t bytes[5];
+	for (int i = 0; i < 5; ++i)
+	{
+		int c = fgetc(file);
+		if (c == EOF)
+			return false;
+		bytes[i] = (uint8_t) c;
+		if (!(c & 0x80))
+		{
+			const uint8_t* p = bytes;
+			return get_varint(p, bytes + i + 1, value);
+		}
+	}
+	return false;
+}
+
+TraceRecorder::TraceRecorder(const std::string& path)
+{
+	m_File = fopen(path.c_str(), "wb");
+	if (m_File == nullptr)
+	{
+		std::cout << "Trace cannot open " << path << std::endl;
+		return;
+	}
+	fwrite(TRACE_MAGIC, 1, 4, m_File);
+	fwrite(&TRACE_VERSION, sizeof(TRACE_VERSION), 1, m_File);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+	if (m_File)
+		fclose(m_File);
+}
+
+void TraceRecorder::begin_frame(int width, int height, int scale)
+{
+	m_InFrame = m_File != nullptr;
+	m_Width	  = width;
+	m_Height  = height;
+	m_Scale	  = scale;
+	m_Calls	  = 0;
+	m_Payload.clear();
+}
+
+void TraceRecorder::record(TraceOp					  op,
+						   uint8_t					  state,
+						   uint32_t					  depth,
+						   std::initializer_list<int> args,
+						   const FillStyle&			  fillStyle)
+{
+	if (!m_InFrame)
+		return;
+	m_Payload.push_back(op);
+	m_Payload.push_back(state);
+	put_varint(m_Payload, (int32_t) depth);
+	for (int arg : args)
+		put_varint(m_Payload, arg);
+
+	m_Params.clear();
+	FillType fill = fillStyle.record(m_Params);
+	m_Payload.push_back(fill);
+	put_varint(m_Payload, (int32_t) m_Params.size());
+	for (int32_t param : m_Params)
+		put_varint(m_Payload, param);
+	++m_Calls;
+}
+
+void TraceRecorder::end_frame()
+{
+	if (!m_InFrame)
+		return;
+	m_InFrame = false;
+
+	m_Header.clear();
+	m_Header.push_back('F');
+	put_varint(m_Header, m_Width);
+	put_varint(m_Header, m_Height);
+	put_varint(m_Header, m_Scale);
+	put_varint(m_Header, (int32_t) m_Calls);
+	put_varint(m_Header, (int32_t) m_Payload.size());
+	fwrite(m_Header.data(), 1, m_Header.size(), m_File);
+	fwrite(m_Payload.data(), 1, m_Payload.size(), m_File);
+}
+
+TraceReader::~TraceReader()
+{
+	if (m_File)
+		fclose(m_File);
+}
+
+bool TraceReader::open(const std::string& path)
+{
+	m_File = fopen(path.c_str(), "rb");
+	if (m_File == nullptr)
+	{
+		std::cout << "Trace cannot open " << path << std::endl;
+		return false;
+	}
+	char	 magic[4];
+	uint32_t version;
+	if (fread(magic, 1, 4, m_File) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0
+		|| fread(&version, sizeof(version), 1, m_File) != 1 || version != TRACE_VERSION)
+	{
+		std::cout << "Not a version " << TRACE_VERSION << " trace: " << path << std::endl;
+		fclose(m_File);
+		m_File = nullptr;
+		return false;
+	}
+	return true;
+}
+
+bool TraceReader::next_frame(TraceFrame& frame)
+{
+	if (m_File == nullptr || fgetc(m_File) != 'F')
+		return false;
+
+	int32_t width, height, scale, calls, bytes;
+	if (!read_varint(m_File, width) || !read_varint(m_File, height) || !read_varint(m_File, scale)
+		|| !read_varint(m_File, calls) || !read_varint(m_File, bytes) || width <= 0 || height <= 0 || scale <= 0
+		|| calls < 0 || bytes < 0)
+		return false;
+	m_Payload.resize(bytes);
+	if (fread(m_Payload.data(), 1, bytes, m_File) != (size_t) bytes)
+		return false;
+
+	frame.width	 = width;
+	frame.height = height;
+	frame.scale	 = scale;
+	frame.calls.resize(calls);
+
+	const uint8_t* p   = m_Payload.data();
+	const uint8_t* end = p + bytes;
+	for (TraceCall& call : frame.calls)
+	{
+		if (p == end || *p >= TRACE_OP_COUNT)
+			return false;
+		call.op = (TraceOp) *p++;
+		if (p == end)
+			return false;
+		call.state = *p++;
+		if ((call.state & TRACE_STATE_BLEND_MASK) >> TRACE_STATE_BLEND_SHIFT >= (int) BlendMode::COUNT)
+			return false;
+		int32_t depth;
+		if (!get_varint(p, end, depth))
+			return false;
+		call.depth = (uint32_t) depth;
+		for (int i = 0; i < trace_op_args(call.op); ++i)
+		{
+			if (!get_varint(p, end, call.args[i]))
+				return false;
+		}
+		int32_t count;
+		if (p == end)
+			return false;
+		call.fill = (FillType) *p++;
+		if (!get_varint(p, end, count) || count < 0)
+			return false;
+		call.params.resize(count);
+		for (int32_t& param : call.params)
+		{
+			if (!get_varint(p, end, param))
+				return false;
+		}
+	}
+	return true;
+}
+
+void TraceCall::execute(Canvas& aCanvas) const
+{
+	aCanvas.set_linear_blending(state & TRACE_STATE_LINEAR);
+	aCanvas.set_blend_mode((BlendMode) ((state & TRACE_STATE_BLEND_MASK) >> TRACE_STATE_BLEND_SHIFT));
+	aCanvas.set_depth(depth);
+
+	const std::vector<int32_t>& v = params;
+	if (fill == FILL_SOLID && v.size() == 4)
+		return execute_with(aCanvas, SolidFill(Color(v[0], v[1], v[2], v[3])));
+	if (fill == FILL_RADIAL_GRADIENT && v.size() == 12)
+		return execute_with(aCanvas,
+							RadialGradientFill({ v[0], v[1] },
+											   v[2],
+											   Color(v[3], v[4], v[5], v[6]),
+											   Color(v[7], v[8], v[9], v[10]),
+											   v[11]));
+	execute_with(aCanvas, SolidFill(Color(255, 0, 255, 255)));
+}
+
+void TraceCall::execute_with(Canvas& aCanvas, const FillStyle& fillStyle) const
+{
+	const int32_t* a = args;
+	switch (op)
+	{
+	case TRACE_RECTANGLE: aCanvas.fill_rectangle(Vector2(a[0], a[1]), a[2], a[3], fillStyle); break;
+	case TRACE_LINE: aCanvas.fill_line(Vector2(a[0], a[1]), Vector2(a[2], a[3]), fillStyle); break;
+	case TRACE_CIRCLE: aCanvas.fill_circle(Vector2(a[0], a[1]), a[2], fillStyle); break;
+	case TRACE_TRIANGLE:
+		aCanvas.fill_triangle(Vector2(a[0], a[1]), Vector2(a[2], a[3]), Vector2(a[4], a[5]), fillStyle);
+		break;
+	case TRACE_RECTANGLE_FIXED:
+		aCanvas.fill_rectangle(FixedVector2::from_raw(a[0], a[1]), a[2], a[3], fillStyle);
+		break;
+	case TRACE_LINE_FIXED:
+		aCanvas.fill_line(FixedVector2::from_raw(a[0], a[1]), FixedVector2::from_raw(a[2], a[3]), fillStyle);
+		break;
+	case TRACE_CIRCLE_FIXED: aCanvas.fill_circle(FixedVector2::from_raw(a[0], a[1]), a[2], fillStyle); break;
+	case TRACE_TRIANGLE_FIXED:
+		aCanvas.fill_triangle(FixedVector2::from_raw(a[0], a[1]),
+							  FixedVector2::from_raw(a[2], a[3]),
+							  FixedVector2::from_raw(a[4], a[5]),
+							  fillStyle);
+		break;
+	default: break;
+	}
+}
+
+};
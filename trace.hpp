@@ -0,0 +1,108 @@
+#pragma once
+
+#include "graphics.hpp"
+#include <cstdio>
+#include <string>
+
+namespace gph
+{
+
+// Draw-call trace layout:
+//   "GTRC", u32 version
+//   per frame: 'F', width, height, scale, call count, payload bytes, payload
+//   per call:  u8 opcode, u8 canvas state, depth, its fixed number of args, u8 FillType,
+//              param count, params
+// Every integer after the file header is a zigzag varint, so small coordinates
+// and colors take one or two bytes.
+enum TraceOp : uint8_t
+{
+	TRACE_RECTANGLE,
+	TRACE_LINE,
+	TRACE_CIRCLE,
+	TRACE_TRIANGLE,
+	TRACE_RECTANGLE_FIXED,
+	TRACE_LINE_FIXED,
+	TRACE_CIRCLE_FIXED,
+	TRACE_TRIANGLE_FIXED,
+	TRACE_OP_COUNT
+};
+
+const char	   TRACE_MAGIC[4] = { 'G', 'T', 'R', 'C' };
+const uint32_t TRACE_VERSION  = 4;
+const int	   TRACE_MAX_ARGS = 6;
+
+// Canvas settings in effect for a call: the linear-blending flag and the
+// BlendMode in bits 1-3.
+const uint8_t TRACE_STATE_LINEAR	 = 1 << 0;
+const int	  TRACE_STATE_BLEND_SHIFT = 1;
+const uint8_t TRACE_STATE_BLEND_MASK  = 7 << TRACE_STATE_BLEND_SHIFT;
+
+int			trace_op_args(TraceOp op);
+const char* trace_op_name(TraceOp op);
+
+struct TraceCall
+{
+	TraceOp				 op;
+	uint8_t				 state;
+	uint32_t			 depth;
+	int32_t				 args[TRACE_MAX_ARGS];
+	FillType			 fill;
+	std::vector<int32_t> params;
+
+	// Re-issues the call on aCanvas with the recorded state and depth. Unknown
+	// fills are drawn as opaque magenta so the covered pixels still cost the
+	// same and stand out in the image.
+	void execute(Canvas& aCanvas) const;
+	void execute_with(Canvas& aCanvas, const FillStyle& fillStyle) const;
+};
+
+struct TraceFrame
+{
+	int					   width, height, scale;
+	std::vector<TraceCall> calls;
+};
+
+// Buffers the calls of one frame in memory and writes them out in end_frame().
+// Calls made outside begin_frame()/end_frame() are not recorded.
+class TraceRecorder
+{
+public:
+	explicit TraceRecorder(const std::string& path);
+	~TraceRecorder();
+
+	bool isOpen() const { return m_File != nullptr; }
+	void begin_frame(int width, int height, int scale = FIXED_ONE);
+	void record(TraceOp					   op,
+				uint8_t					   state,
+				uint32_t				   depth,
+				std::initializer_list<int> args,
+				const FillStyle&		   fillStyle);
+	void end_frame();
+
+	TraceRecorder(const TraceRecorder&)			   = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+protected:
+	FILE*				 m_File;
+	bool				 m_InFrame = false;
+	int					 m_Width = 0, m_Height = 0, m_Scale = FIXED_ONE;
+	uint32_t			 m_Calls = 0;
+	std::vector<uint8_t> m_Payload;
+	std::vector<uint8_t> m_Header;
+	std::vector<int32_t> m_Params;
+};
+
+class TraceReader
+{
+public:
+	bool open(const std::string& path);
+	bool next_frame(TraceFrame& frame);
+
+	~TraceReader();
+
+protected:
+	FILE*				 m_File = nullptr;
+	std::vector<uint8_t> m_Payload;
+};
+
+};
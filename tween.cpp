@@ -0,0 +1,189 @@
+#include "tween.hpp"
+
+namespace gph
+{
+
+template <Ease E> static inline float ease(float t);
+template <> inline float ease<Ease::Linear>(float t) { return t; }
+template <> inline float ease<Ease::Smoothstep>(float t) { return t * t * (3 - t * 2); }
+template <> inline float ease<Ease::InQuad>(float t) { return t * t; }
+template <> inline float ease<Ease::OutQuad>(float t) { return t * (2 - t); }
+template <> inline float ease<Ease::InOutQuad>(float t)
+{
+	float u = 1 - t;
+	return t < 0.5f ? 2 * t * t : 1 - 2 * u * u;
+}
+template <> inline float ease<Ease::InCubic>(float t) { return t * t * t; }
+template <> inline float ease<Ease::OutCubic>(float t)
+{
+	float u = 1 - t;
+	return 1 - u * u * u;
+}
+
+template <Ease E>
+static void advance(float now, size_t count, const float* from, const float* delta, const float* start,
+					const float* invDuration, float* value)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		float t	 = (now - start[i]) * invDuration[i];
+		t		 = std::min(std::max(t, 0.0f), 1.0f);
+		value[i] = from[i] + delta[i] * ease<E>(t);
+	}
+}
+
+typedef void (*AdvanceFn)(float, size_t, const float*, const float*, const float*, const float*, float*);
+
+static const AdvanceFn advanceFns[(int) Ease::COUNT] = { advance<Ease::Linear>,	   advance<Ease::Smoothstep>,
+														  advance<Ease::InQuad>,	   advance<Ease::OutQuad>,
+														  advance<Ease::InOutQuad>, advance<Ease::InCubic>,
+														  advance<Ease::OutCubic> };
+
+void TweenSystem::push(void* target, bool isInt, float from, float to, float duration, Ease ease, float delay,
+					   uint32_t tag)
+{
+	Bucket& b = buckets[(int) ease];
+	b.from.push_back(from);
+	b.delta.push_back(to - from);
+	b.start.push_back(now + delay);
+	// A zero duration finishes on the first update.
+	b.invDuration.push_back(duration > 0 ? 1 / duration : 1e30f);
+	b.value.push_back(from);
+	b.target.push_back(target);
+	b.isInt.push_back(isInt);
+	b.tag.push_back(tag);
+}
+
+void TweenSystem::add(float* target, float to, float duration, Ease ease, float delay, uint32_t tag)
+{
+	push(target, false, *target, to, duration, ease, delay, tag);
+}
+
+void TweenSystem::add(int* target, int to, float duration, Ease ease, float delay, uint32_t tag)
+{
+	push(target, true, *target, to, duration, ease, delay, tag);
+}
+
+void TweenSystem::add(Vector2* target, Vector2 to, float duration, Ease ease, float delay, uint32_t tag)
+{
+	push(&target->x, true, target->x, to.x, duration, ease, delay, 0);
+	push(&target->y, true, target->y, to.y, duration, ease, delay, tag);
+}
+
+void TweenSystem::add(Color* target, Color to, float duration, Ease ease, float delay, uint32_t tag)
+{
+	push(&target->r, true, target->r, to.r, duration, ease, delay, 0);
+	push(&target->g, true, target->g, to.g, duration, ease, delay, 0);
+	push(&target->b, true, target->b, to.b, duration, ease, delay, 0);
+	push(&target->a, true, target->a, to.a, duration, ease, delay, tag);
+}
+
+void TweenSystem::remove(Bucket& b, size_t index)
+{
+	size_t last		   = b.from.size() - 1;
+	b.from[index]		 = b.from[last];
+	b.delta[index]		 = b.delta[last];
+	b.start[index]		 = b.start[last];
+	b.invDuration[index] = b.invDuration[last];
+	b.value[index]		 = b.value[last];
+	b.target[index]		 = b.target[last];
+	b.isInt[index]		 = b.isInt[last];
+	b.tag[index]		 = b.tag[last];
+	b.from.pop_back();
+	b.delta.pop_back();
+	b.start.pop_back();
+	b.invDuration.pop_back();
+	b.value.pop_back();
+	b.target.pop_back();
+	b.isInt.pop_back();
+	b.tag.pop_back();
+}
+
+// Clock value at which now and every start time are shifted back to zero, so
+// they stay small enough for float to resolve a frame.
+static const float REBASE_SECONDS = 1024;
+
+void TweenSystem::update(float dt)
+{
+	now += dt;
+	completed.clear();
+	if (now >= REBASE_SECONDS)
+	{
+		for (Bucket& b : buckets)
+		{
+			for (float& start : b.start)
+				start -= now;
+		}
+		now = 0;
+	}
+
+	for (int e = 0; e < (int) Ease::COUNT; ++e)
+	{
+		Bucket& b	  = buckets[e];
+		size_t	count = b.from.size();
+		if (count == 0)
+			continue;
+
+		advanceFns[e](now, count, b.from.data(), b.delta.data(), b.start.data(), b.invDuration.data(), b.value.data());
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (b.isInt[i])
+				*(int*) b.target[i] = (int) lroundf(b.value[i]);
+			else
+				*(float*) b.target[i] = b.value[i];
+		}
+
+		// Walk backwards so swap-removal never skips an element.
+		for (size_t i = count; i-- > 0;)
+		{
+			if ((now - b.start[i]) * b.invDuration[i] < 1)
+				continue;
+			if (b.tag[i])
+				completed.push_back(b.tag[i]);
+			remove(b, i);
+		}
+	}
+
+	if (!completed.empty() && onComplete)
+		onComplete(completed.data(), completed.size());
+}
+
+void TweenSystem::cancel_range(const void* target, size_t bytes)
+{
+	const char* begin = (const char*) target;
+	for (Bucket& b : buckets)
+	{
+		for (size_t i = b.target.size(); i-- > 0;)
+		{
+			const char* p = (const char*) b.target[i];
+			if (p >= begin && p < begin + bytes)
+				remove(b, i);
+		}
+	}
+}
+
+void TweenSystem::clear()
+{
+	for (Bucket& b : buckets)
+	{
+		b.from.clear();
+		b.delta.clear();
+		b.start.clear();
+		b.invDuration.clear();
+		b.value.clear();
+		b.target.clear();
+		b.isInt.clear();
+		b.tag.clear();
+	}
+}
+
+size_t TweenSystem::size() const
+{
+	size_t total = 0;
+	for (const Bucket& b : buckets)
+		total += b.from.size();
+	return total;
+}
+
+};
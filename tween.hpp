@@ -0,0 +1,67 @@
+#pragma once
+
+#include "graphics.hpp"
+#include <functional>
+
+namespace gph
+{
+
+enum class Ease : uint8_t
+{
+	Linear,
+	Smoothstep,
+	InQuad,
+	OutQuad,
+	InOutQuad,
+	InCubic,
+	OutCubic,
+	COUNT
+};
+
+// Animates thousands of float/int properties at once. Tweens are kept in one
+// structure-of-arrays bucket per easing curve, so update() runs a branch-free
+// loop per curve that the compiler can vectorize, then scatters the results to
+// their targets. Targets must outlive their tweens (or be cancel()ed).
+//
+// Tweens added with a non-zero tag report it through the completion callback;
+// all tags finishing in one update() are delivered in a single call.
+class TweenSystem
+{
+public:
+	typedef std::function<void(const uint32_t* tags, size_t count)> CompleteCallback;
+
+	void add(float* target, float to, float duration, Ease ease = Ease::Smoothstep, float delay = 0, uint32_t tag = 0);
+	void add(int* target, int to, float duration, Ease ease = Ease::Smoothstep, float delay = 0, uint32_t tag = 0);
+	void add(Vector2* target, Vector2 to, float duration, Ease ease = Ease::Smoothstep, float delay = 0, uint32_t tag = 0);
+	void add(Color* target, Color to, float duration, Ease ease = Ease::Smoothstep, float delay = 0, uint32_t tag = 0);
+
+	void   update(float dt);
+	void   cancel(const float* target) { cancel_range(target, sizeof(*target)); }
+	void   cancel(const int* target) { cancel_range(target, sizeof(*target)); }
+	void   cancel(const Vector2* target) { cancel_range(target, sizeof(*target)); }
+	void   cancel(const Color* target) { cancel_range(target, sizeof(*target)); }
+	void   clear();
+	size_t size() const;
+
+	void set_on_complete(CompleteCallback aCallback) { onComplete = aCallback; }
+
+protected:
+	struct Bucket
+	{
+		std::vector<float>	  from, delta, start, invDuration, value;
+		std::vector<void*>	  target;
+		std::vector<uint8_t>  isInt;
+		std::vector<uint32_t> tag;
+	};
+
+	void push(void* target, bool isInt, float from, float to, float duration, Ease ease, float delay, uint32_t tag);
+	void remove(Bucket& bucket, size_t index);
+	void cancel_range(const void* target, size_t bytes);
+
+	Bucket				  buckets[(int) Ease::COUNT];
+	float				  now = 0;
+	std::vector<uint32_t> completed;
+	CompleteCallback	  onComplete;
+};
+
+};
@@ -0,0 +1,101 @@
+#include "upscale.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace gph
+{
+
+void upscale_nearest(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, unsigned char* dst,
+					 int dstWidth, int dstHeight, int dstStride, FrameArena& scratch)
+{
+	int* column = scratch.allocate_array<int>(dstWidth);
+	for (int x = 0; x < dstWidth; ++x)
+		column[x] = (int) ((int64_t) x * srcWidth / dstWidth);
+
+	int lastRow = -1;
+	for (int y = 0; y < dstHeight; ++y)
+	{
+		int		 row = (int) ((int64_t) y * srcHeight / dstHeight);
+		uint32_t* out = (uint32_t*) (dst + (size_t) y * dstStride);
+		// Output rows that sample the same source row are plain copies.
+		if (row == lastRow)
+		{
+			memcpy(out, dst + (size_t) (y - 1) * dstStride, (size_t) dstWidth * 4);
+			continue;
+		}
+		const uint32_t* in = (const uint32_t*) (src + (size_t) row * srcStride);
+		for (int x = 0; x < dstWidth; ++x)
+			out[x] = in[column[x]];
+		lastRow = row;
+	}
+}
+
+// Bilinear weights are 7-bit (0..128) so 16-bit lane products of a channel
+// difference and a weight cannot overflow.
+static const int WEIGHT_BITS = 7;
+static const int WEIGHT_ONE	 = 1 << WEIGHT_BITS;
+
+void upscale_bilinear(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, unsigned char* dst,
+					  int dstWidth, int dstHeight, int dstStride, FrameArena& scratch)
+{
+	if (srcWidth < 2 || srcHeight < 2)
+		return upscale_nearest(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight, dstStride, scratch);
+
+	// Sample at pixel centers. x0 stays at most srcWidth - 2 so x0 + 1 is always
+	// readable; past the last center the weight saturates instead.
+	int* column = scratch.allocate_array<int>(dstWidth);
+	int* weight = scratch.allocate_array<int>(dstWidth);
+	for (int x = 0; x < dstWidth; ++x)
+	{
+		int64_t pos = std::max<int64_t>(((2 * (int64_t) x + 1) * srcWidth * WEIGHT_ONE) / (2 * dstWidth) - WEIGHT_ONE / 2, 0);
+		int		x0	= std::min((int) (pos >> WEIGHT_BITS), srcWidth - 2);
+		column[x]	= x0;
+		weight[x]	= (int) std::min<int64_t>(pos - (int64_t) x0 * WEIGHT_ONE, WEIGHT_ONE);
+	}
+
+	for (int y = 0; y < dstHeight; ++y)
+	{
+		int64_t pos = std::max<int64_t>(((2 * (int64_t) y + 1) * srcHeight * WEIGHT_ONE) / (2 * dstHeight) - WEIGHT_ONE / 2, 0);
+		int		y0	= std::min((int) (pos >> WEIGHT_BITS), srcHeight - 2);
+		int		fy	= (int) std::min<int64_t>(pos - (int64_t) y0 * WEIGHT_ONE, WEIGHT_ONE);
+
+		const unsigned char* top	= src + (size_t) y0 * srcStride;
+		const unsigned char* bottom = top + srcStride;
+		unsigned char*		 out	= dst + (size_t) y * dstStride;
+
+#ifdef __SSE2__
+		__m128i zero = _mm_setzero_si128();
+		__m128i wy	 = _mm_set1_epi16((short) fy);
+		for (int x = 0; x < dstWidth; ++x)
+		{
+			// Lanes 0-3 hold the left pixel, lanes 4-7 the right one.
+			__m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (top + column[x] * 4)), zero);
+			__m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) (bottom + column[x] * 4)), zero);
+			__m128i v = _mm_add_epi16(t, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(b, t), wy), WEIGHT_BITS));
+			__m128i r = _mm_srli_si128(v, 8);
+			__m128i h = _mm_add_epi16(
+				v, _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(r, v), _mm_set1_epi16((short) weight[x])), WEIGHT_BITS));
+			*(int*) (out + x * 4) = _mm_cvtsi128_si32(_mm_packus_epi16(h, zero));
+		}
+#else
+		for (int x = 0; x < dstWidth; ++x)
+		{
+			const unsigned char* t	= top + column[x] * 4;
+			const unsigned char* b	= bottom + column[x] * 4;
+			int					 fx = weight[x];
+			for (int c = 0; c < 4; ++c)
+			{
+				int left	   = t[c] + (((b[c] - t[c]) * fy) >> WEIGHT_BITS);
+				int right	   = t[c + 4] + (((b[c + 4] - t[c + 4]) * fy) >> WEIGHT_BITS);
+				out[x * 4 + c] = left + (((right - left) * fx) >> WEIGHT_BITS);
+			}
+		}
+#endif
+	}
+}
+
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "arena.hpp"
+
+namespace gph
+{
+
+enum class Upscale
+{
+	Nearest,
+	Bilinear
+};
+
+// Stretch a BGRA image over another. Strides are in bytes; scratch holds the
+// per-column lookup tables for the call.
+void upscale_nearest(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, unsigned char* dst,
+					 int dstWidth, int dstHeight, int dstStride, FrameArena& scratch);
+void upscale_bilinear(const unsigned char* src, int srcWidth, int srcHeight, int srcStride, unsigned char* dst,
+					  int dstWidth, int dstHeight, int dstStride, FrameArena& scratch);
+
+};
@@ -0,0 +1,199 @@
+#include "graphics.hpp"
+#include "capture.hpp"
+#include "trace.hpp"
+
+namespace gph
+{
+
+GWindow::GWindow(int width, int height, std::string title, bool hugePages)
+: Canvas(width, height, hugePages)
+, WINDOW_TITLE(title)
+, program_start_clock(std::chrono::high_resolution_clock::now())
+, m_OutputWidth(width)
+, m_OutputHeight(height)
+{
+	m_Display = XOpenDisplay(NIL);
+	assert(m_Display);
+
+	elapsed_time	= std::chrono::high_resolution_clock::now() - program_start_clock;
+	double_timestep = (sin(elapsed_time.count()) + 1) / 2.0;
+
+	int blackColor = BlackPixel(m_Display, DefaultScreen(m_Display));
+	int whiteColor = WhitePixel(m_Display, DefaultScreen(m_Display));
+
+	m_Window = XCreateSimpleWindow(m_Display,
+								   DefaultRootWindow(m_Display),
+								   0,
+								   0,
+								   WINDOW_WIDTH,
+								   WINDOW_HEIGHT,
+								   0,
+								   blackColor,
+								   blackColor);
+
+	XSelectInput(m_Display, m_Window, StructureNotifyMask | ExposureMask | KeyPressMask);
+
+	XMapWindow(m_Display, m_Window);
+
+	m_Graphics = XCreateGC(m_Display, m_Window, 0, NIL);
+	m_Visual   = DefaultVisual(m_Display, DefaultScreen(m_Display));
+
+	m_Image = create_ximage(m_Display, m_Visual, m_OutputWidth, m_OutputHeight);
+
+	bool drawMode = false;
+	bool exposed  = false;
+	bool quit	  = false;
+
+	Start();
+
+	for (;;)
+	{
+		while (XPending(m_Display))
+		{
+			XNextEvent(m_Display, &m_Event);
+			if (m_Event.type == MapNotify)
+				drawMode = true;
+			else if (m_Event.type == Expose)
+				exposed = true;
+			else if (m_Event.type == ConfigureNotify)
+				resize_window(m_Event.xconfigure.width, m_Event.xconfigure.height);
+			else if (m_Event.type == KeyPress)
+				quit = true;
+		}
+		if (quit)
+		{
+			break;
+		}
+		if (drawMode && exposed)
+		{
+			auto	 frameStart			   = std::chrono::high_resolution_clock::now();
+			uint64_t frameStartAllocations = heap_allocation_count();
+			clear();
+
+			if (m_Trace)
+				m_Trace->begin_frame(WINDOW_WIDTH, WINDOW_HEIGHT, m_Scale);
+			Update();
+			if (m_Trace)
+				m_Trace->end_frame();
+
+			present();
+			XPutImage(m_Display, m_Window, m_Graphics, m_Image, 0, 0, 0, 0, m_OutputWidth, m_OutputHeight);
+			if (m_Capture)
+				m_Capture->submit((unsigned char*) m_Image->data, m_OutputWidth, m_OutputHeight);
+
+			m_Arena.reset();
+			m_FrameAllocations = heap_allocation_count() - frameStartAllocations;
+
+			std::chrono::duration<double> frameTime = std::chrono::high_resolution_clock::now() - frameStart;
+			if (m_AutoScale)
+				adjust_auto_scale(frameTime.count());
+		}
+
+		elapsed_time	= std::chrono::high_resolution_clock::now() - program_start_clock;
+		double_timestep = (sin(elapsed_time.count()) + 1) / 2.0;
+		Tick();
+	}
+
+	XCloseDisplay(m_Display);
+	XDestroyWindow(m_Display, m_Window);
+	destroy_ximage();
+};
+
+GWindow::~GWindow() { Close(); }
+
+XImage* GWindow::create_ximage(Display* display, Visual* visual, int width, int height)
+{
+	// The pixels come from the surface pool; destroy_ximage() hands them back.
+	unsigned char* image32 = (unsigned char*) m_Pool.acquire(width * height * BYTES_PER_PIXEL, m_HugePages);
+	memset(image32, 255, width * height * BYTES_PER_PIXEL);
+	return XCreateImage(display, visual, 24, ZPixmap, 0, (char*) image32, width, height, 32, 0);
+}
+
+void GWindow::destroy_ximage()
+{
+	m_Pool.release(m_Image->data);
+	m_Image->data = nullptr;
+	XDestroyImage(m_Image);
+	m_Image = nullptr;
+}
+
+void GWindow::resize_window(int width, int height)
+{
+	if (width == m_OutputWidth && height == m_OutputHeight)
+		return;
+	m_OutputWidth  = width;
+	m_OutputHeight = height;
+	destroy_ximage();
+	m_Image = create_ximage(m_Display, m_Visual, width, height);
+	apply_render_scale();
+}
+
+void GWindow::set_render_scale(float scale)
+{
+	m_AutoScale	  = false;
+	m_RenderScale = scale;
+	apply_render_scale();
+}
+
+void GWindow::set_auto_scale(double targetSeconds, float minScale)
+{
+	m_AutoScale		   = true;
+	m_TargetFrameTime  = targetSeconds;
+	m_MinScale		   = minScale;
+	m_AverageFrameTime = 0;
+	m_FramesSinceScale = 0;
+}
+
+void GWindow::apply_render_scale()
+{
+	int scale = std::max(to_fixed(m_RenderScale), 1);
+	resize(std::max((int) ((int64_t) m_OutputWidth * scale >> FIXED_SHIFT), 1),
+		   std::max((int) ((int64_t) m_OutputHeight * scale >> FIXED_SHIFT), 1));
+	set_scale(scale);
+}
+
+void GWindow::present()
+{
+	unsigned char* out = (unsigned char*) m_Image->data;
+	if (WINDOW_WIDTH == m_OutputWidth && WINDOW_HEIGHT == m_OutputHeight)
+		memcpy(out, screenbuffer, WINDOW_PIXEL);
+	else if (m_Upscale == Upscale::Nearest)
+		upscale_nearest(screenbuffer, WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_WIDTH * BYTES_PER_PIXEL, out,
+						m_OutputWidth, m_OutputHeight, m_Image->bytes_per_line, m_Arena);
+	else
+		upscale_bilinear(screenbuffer, WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_WIDTH * BYTES_PER_PIXEL, out,
+						 m_OutputWidth, m_OutputHeight, m_Image->bytes_per_line, m_Arena);
+}
+
+void GWindow::adjust_auto_scale(double frameSeconds)
+{
+	// Smooth over a few frames and leave time between changes so one slow
+	// frame doesn't make the resolution oscillate.
+	const int	 SETTLE_FRAMES = 30;
+	const double SMOOTHING	   = 0.1;
+
+	m_AverageFrameTime = m_AverageFrameTime == 0 ? frameSeconds
+												 : m_AverageFrameTime + (frameSeconds - m_AverageFrameTime) * SMOOTHING;
+	if (++m_FramesSinceScale < SETTLE_FRAMES)
+		return;
+
+	float scale = m_RenderScale;
+	if (m_AverageFrameTime > m_TargetFrameTime)
+		scale = std::max(m_RenderScale * 0.9f, m_MinScale);
+	else if (m_AverageFrameTime < m_TargetFrameTime * 0.6)
+		scale = std::min(m_RenderScale * 1.1f, 1.0f);
+	if (scale != m_RenderScale)
+	{
+		m_RenderScale = scale;
+		apply_render_scale();
+		m_FramesSinceScale = 0;
+	}
+}
+
+void GWindow::set_screen(unsigned char* rgb_out, int w, int h)
+{
+	std::strncpy((char*) rgb_out, (const char*) screenbuffer, w * h * BYTES_PER_PIXEL);
+	return;
+}
+
+};